@@ -0,0 +1,574 @@
+// Per-command overhead benchmarks. Translation runs against MockGeminiServer,
+// so the numbers cover our side of the wire: context collection, request
+// building, curl, SSE/JSON parsing and command extraction.
+//
+// Latency benchmarks report p50_us/p99_us counters over their iterations;
+// throughput is items_per_second.
+
+#include "ganpi.h"
+#include "mock_gemini_server.h"
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <regex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ganpi;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Per-iteration latencies, published as percentile counters when the run ends
+class Latencies {
+public:
+    explicit Latencies(benchmark::State& state) : state_(state) {}
+    ~Latencies() {
+        if (samples_.empty()) return;
+        std::sort(samples_.begin(), samples_.end());
+        state_.counters["p50_us"] = percentile(0.50);
+        state_.counters["p99_us"] = percentile(0.99);
+    }
+    void add(Clock::time_point start) {
+        samples_.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+
+private:
+    benchmark::State& state_;
+    std::vector<double> samples_;
+
+    double percentile(double p) const {
+        size_t index = static_cast<size_t>(p * static_cast<double>(samples_.size() - 1) + 0.5);
+        return samples_[index];
+    }
+};
+
+int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+    return ::remove(path);
+}
+
+// Temporary directory trees with a given number of entries, made on first
+// use and removed at exit
+class Fixtures {
+public:
+    ~Fixtures() {
+        for (const auto& path : paths_) {
+            nftw(path.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+        }
+    }
+
+    const std::string& tree(size_t entries) {
+        for (size_t i = 0; i < sizes_.size(); ++i) {
+            if (sizes_[i] == entries) return paths_[i];
+        }
+        char path[] = "/tmp/ganpi_bench.XXXXXX";
+        if (!mkdtemp(path)) {
+            std::perror("mkdtemp");
+            std::exit(1);
+        }
+        // A tenth directories (each with a few files), the rest files of mixed types
+        static const char* const EXTENSIONS[] = {".cpp", ".h", ".txt", ".pdf", ".jpg", ".md", ".log", ""};
+        std::string root = path;
+        for (size_t i = 0; i < entries; ++i) {
+            std::string name = root + "/entry" + std::to_string(i);
+            if (i % 10 == 0) {
+                mkdir(name.c_str(), 0755);
+                for (int j = 0; j < 3; ++j) {
+                    std::ofstream(name + "/file" + std::to_string(j) + ".txt") << "x";
+                }
+            } else {
+                std::ofstream(name + EXTENSIONS[i % 8]) << std::string(i % 4096, 'x');
+            }
+        }
+        for (const char* dir : {"test", "documents", "downloads"}) {
+            mkdir((root + "/" + dir).c_str(), 0755);
+        }
+        sizes_.push_back(entries);
+        paths_.push_back(root);
+        return paths_.back();
+    }
+
+private:
+    std::vector<size_t> sizes_;
+    std::vector<std::string> paths_;
+};
+
+Fixtures& fixtures() {
+    static Fixtures instance;
+    return instance;
+}
+
+// Runs the benchmark body inside a fixture tree, since context is collected from "."
+class WorkingDirectory {
+public:
+    explicit WorkingDirectory(const std::string& path) {
+        if (getcwd(saved_, sizeof(saved_)) == nullptr || chdir(path.c_str()) != 0) {
+            std::perror("chdir");
+            std::exit(1);
+        }
+    }
+    ~WorkingDirectory() {
+        if (chdir(saved_) != 0) std::perror("chdir");
+    }
+
+private:
+    char saved_[4096];
+};
+
+MockGeminiServer& server() {
+    static MockGeminiServer instance;
+    return instance;
+}
+
+// A client that always goes to the mock server
+std::unique_ptr<GeminiClient> makeClient(bool streaming) {
+    auto client = std::make_unique<GeminiClient>("bench-key");
+    client->setBaseUrl(server().baseUrl());
+    client->setStreaming(streaming);
+    client->setLocalIntentThreshold(2.0);
+    return client;
+}
+
+const std::vector<std::string>& sampleQueries() {
+    static const std::vector<std::string> queries = {
+        "list all files in the test directory",
+        "move the pdf files from downloads to documents",
+        "find all jpg images bigger than 1MB",
+        "create a backup directory in the documents folder",
+        "show disk usage of each folder sorted by size",
+        "count lines in all cpp files",
+        "delete the temp folder",
+        "start an http server on port 8080",
+    };
+    return queries;
+}
+
+// --- Translation against the mock server ------------------------------------
+
+// Args: server latency (ms), response size (bytes), streaming (0/1)
+void BM_Translate(benchmark::State& state) {
+    WorkingDirectory cwd(fixtures().tree(100));
+    server().setLatency(std::chrono::milliseconds(state.range(0)));
+    server().setResponseBytes(static_cast<size_t>(state.range(1)));
+    auto client = makeClient(state.range(2) != 0);
+    const auto& queries = sampleQueries();
+
+    Latencies latencies(state);
+    size_t i = 0;
+    for (auto _ : state) {
+        auto start = Clock::now();
+        std::string command = client->interpretCommand(queries[i++ % queries.size()]);
+        latencies.add(start);
+        if (command.empty()) {
+            state.SkipWithError("empty command from mock server");
+            break;
+        }
+        benchmark::DoNotOptimize(command);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["connections"] = static_cast<double>(client->connectionsOpened());
+}
+BENCHMARK(BM_Translate)
+    ->ArgNames({"latency_ms", "bytes", "stream"})
+    ->ArgsProduct({{0, 20}, {1 << 10, 64 << 10}, {0, 1}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// Arg: every nth API call fails with 503 and is retried (0 = no failures)
+void BM_TranslateRetry(benchmark::State& state) {
+    WorkingDirectory cwd(fixtures().tree(100));
+    server().setLatency(std::chrono::milliseconds(5));
+    server().setResponseBytes(1 << 10);
+    server().setFailureEvery(static_cast<int>(state.range(0)), 503);
+    auto client = makeClient(false);
+    GeminiClient::RequestPolicy policy;
+    policy.retry_base_ms = 1;
+    client->setRequestPolicy(policy);
+    const auto& queries = sampleQueries();
+
+    {
+        Latencies latencies(state);
+        size_t i = 0;
+        for (auto _ : state) {
+            auto start = Clock::now();
+            std::string command = client->interpretCommand(queries[i++ % queries.size()]);
+            latencies.add(start);
+            if (command.empty()) {
+                state.SkipWithError(("no command: " + client->lastError()).c_str());
+                break;
+            }
+        }
+    }
+    server().setFailureEvery(0, 503);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TranslateRetry)
+    ->ArgName("fail_every")->Arg(0)->Arg(4)->Arg(2)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// Every 25th API call stalls for 200 ms. Arg: hedge after this many ms (0 =
+// no hedging, -1 = the p95 of recent calls); compare p99_us.
+void BM_TranslateHedged(benchmark::State& state) {
+    WorkingDirectory cwd(fixtures().tree(100));
+    server().setLatency(std::chrono::milliseconds(5));
+    server().setResponseBytes(1 << 10);
+    server().setSlowEvery(25, std::chrono::milliseconds(200));
+    auto client = makeClient(false);
+    GeminiClient::RequestPolicy policy;
+    policy.hedge_after_ms = state.range(0);
+    client->setRequestPolicy(policy);
+    const auto& queries = sampleQueries();
+
+    {
+        Latencies latencies(state);
+        size_t i = 0;
+        for (auto _ : state) {
+            auto start = Clock::now();
+            std::string command = client->interpretCommand(queries[i++ % queries.size()]);
+            latencies.add(start);
+            benchmark::DoNotOptimize(command);
+        }
+    }
+    server().setSlowEvery(0, std::chrono::milliseconds(0));
+    state.SetItemsProcessed(state.iterations());
+    state.counters["connections"] = static_cast<double>(client->connectionsOpened());
+}
+BENCHMARK(BM_TranslateHedged)
+    ->ArgName("hedge_ms")->Arg(0)->Arg(20)->Arg(-1)
+    ->Iterations(100)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// A batch of N translations in flight at once on the async engine
+void BM_TranslateBatch(benchmark::State& state) {
+    WorkingDirectory cwd(fixtures().tree(100));
+    server().setLatency(std::chrono::milliseconds(20));
+    server().setResponseBytes(1 << 10);
+    auto client = makeClient(false);
+
+    std::vector<std::string> batch;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        batch.push_back(sampleQueries()[static_cast<size_t>(i) % sampleQueries().size()]);
+    }
+
+    Latencies latencies(state);
+    for (auto _ : state) {
+        auto start = Clock::now();
+        auto commands = client->interpretBatch(batch, batch.size());
+        latencies.add(start);
+        benchmark::DoNotOptimize(commands);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TranslateBatch)
+    ->ArgName("concurrency")
+    ->Arg(1)->Arg(16)->Arg(128)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Translate, then run the command through the safety checks and execute it
+void BM_EndToEnd(benchmark::State& state) {
+    WorkingDirectory cwd(fixtures().tree(100));
+    server().setLatency(std::chrono::milliseconds(state.range(0)));
+    server().setResponseBytes(1 << 10);
+    auto client = makeClient(true);
+    CommandExecutor executor;
+    executor.setStreamOutput(false);
+    const auto& queries = sampleQueries();
+
+    Latencies latencies(state);
+    size_t i = 0;
+    for (auto _ : state) {
+        auto start = Clock::now();
+        std::string command = client->interpretCommand(queries[i++ % queries.size()]);
+        auto result = executor.execute(command);
+        latencies.add(start);
+        if (!result.success) {
+            state.SkipWithError(("command failed: " + command).c_str());
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EndToEnd)
+    ->ArgName("latency_ms")
+    ->Arg(0)->Arg(20)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// --- File system context ----------------------------------------------------
+
+// Fresh collector each time: every directory is read and watched from scratch
+void BM_ContextCold(benchmark::State& state) {
+    WorkingDirectory cwd(fixtures().tree(static_cast<size_t>(state.range(0))));
+    Latencies latencies(state);
+    for (auto _ : state) {
+        auto start = Clock::now();
+        ContextCollector collector;
+        std::string context = collector.collect("list the files in the test directory");
+        latencies.add(start);
+        benchmark::DoNotOptimize(context);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ContextCold)->ArgName("entries")->Arg(100)->Arg(1000)->Arg(10000)
+    ->Unit(benchmark::kMicrosecond);
+
+// Reused collector: listings come from the snapshot cache
+void BM_ContextWarm(benchmark::State& state) {
+    WorkingDirectory cwd(fixtures().tree(static_cast<size_t>(state.range(0))));
+    ContextCollector collector;
+    collector.setTokenBudget(static_cast<size_t>(state.range(1)));
+    collector.collect("warm up");
+
+    Latencies latencies(state);
+    for (auto _ : state) {
+        auto start = Clock::now();
+        std::string context = collector.collect("list the files in the test directory");
+        latencies.add(start);
+        benchmark::DoNotOptimize(context);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["tokens"] = static_cast<double>(collector.lastStats().tokens);
+    state.counters["level"] = collector.lastStats().level;
+}
+BENCHMARK(BM_ContextWarm)
+    ->ArgNames({"entries", "budget"})
+    ->ArgsProduct({{100, 1000, 10000}, {0, 3000}})
+    ->Unit(benchmark::kMicrosecond);
+
+// The pwd/ls/find chain ContextCollector replaced, one shell per section as
+// it was; the baseline for the two above
+std::string captureShell(const std::string& command) {
+    std::string output;
+    FILE* pipe = popen(("bash -c \"" + command + "\"").c_str(), "r");
+    if (!pipe) return output;
+    char buffer[256];
+    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
+        output += buffer;
+    }
+    pclose(pipe);
+    return output;
+}
+
+void BM_ContextForked(benchmark::State& state) {
+    WorkingDirectory cwd(fixtures().tree(static_cast<size_t>(state.range(0))));
+    std::string query = "list the files in the test directory";
+    Latencies latencies(state);
+    for (auto _ : state) {
+        auto start = Clock::now();
+        std::string context = "\n=== FILE SYSTEM CONTEXT ===\n";
+        context += "Current directory: " + captureShell("pwd");
+        context += "\n--- Current Directory Structure ---\n" + captureShell("ls -lAh 2>/dev/null");
+        context += "\n--- Directory Tree (2 levels) ---\n" +
+                   captureShell("find . -maxdepth 2 -type d 2>/dev/null | head -30");
+        context += "\n--- All Files in Current Directory ---\n" +
+                   captureShell("find . -maxdepth 1 -type f 2>/dev/null");
+        std::regex dir_pattern(R"(\b(test|dir1|dir2|downloads?|documents?|backup|temp|home|desktop)\b)");
+        std::set<std::string> found_dirs;
+        for (std::sregex_iterator it(query.begin(), query.end(), dir_pattern), end; it != end; ++it) {
+            found_dirs.insert((*it)[0]);
+        }
+        if (!found_dirs.empty()) {
+            context += "\n--- Mentioned Directories ---\n";
+            for (const auto& dir : found_dirs) {
+                context += "\nContents of " + dir + "/:\n" + captureShell("ls -lAh " + dir + " 2>/dev/null | head -30");
+            }
+        }
+        latencies.add(start);
+        benchmark::DoNotOptimize(context);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ContextForked)->ArgName("entries")->Arg(100)->Arg(1000)->Arg(10000)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// --- Execution --------------------------------------------------------------
+
+// Spawn and reap cost with output capture
+void BM_Execute(benchmark::State& state) {
+    CommandExecutor executor;
+    executor.setStreamOutput(false);
+    std::string command = state.range(0) == 0 ? "true" : "head -c " + std::to_string(state.range(0)) + " /dev/zero";
+
+    Latencies latencies(state);
+    for (auto _ : state) {
+        auto start = Clock::now();
+        auto result = executor.execute(command);
+        latencies.add(start);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Execute)->ArgName("output_bytes")->Arg(0)->Arg(1 << 20)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// --- Safety checks ----------------------------------------------------------
+
+// Random rules and commands, some of which contain a rule
+struct SafetyCorpus {
+    SafetyEngine engine;
+    std::vector<std::string> commands;
+
+    SafetyCorpus(size_t rules, size_t command_count) {
+        std::mt19937 random(42);
+        auto word = [&random]() {
+            std::string text;
+            size_t length = 3 + random() % 6;
+            for (size_t i = 0; i < length; ++i) text += static_cast<char>('a' + random() % 26);
+            return text;
+        };
+        std::vector<std::string> patterns;
+        for (size_t i = 0; i < rules; ++i) {
+            patterns.push_back(word() + " --" + word());
+            engine.addRule(i % 4 == 0 ? SafetyEngine::Verdict::Block : SafetyEngine::Verdict::Warn,
+                           patterns.back());
+        }
+        engine.compile();
+
+        static const char* const TEMPLATES[] = {
+            "ls -la ", "find . -name '*.", "grep -rn TODO ", "cp -r src/", "tar czf backup.tgz ",
+        };
+        for (size_t i = 0; i < command_count; ++i) {
+            std::string command = TEMPLATES[i % 5] + word() + " | sort | head -20";
+            if (i % 50 == 0) command += " && " + patterns[random() % patterns.size()];
+            commands.push_back(command);
+        }
+    }
+};
+
+const SafetyCorpus& safetyCorpus() {
+    static const SafetyCorpus corpus(3000, 100000);
+    return corpus;
+}
+
+void BM_SafetyScan(benchmark::State& state) {
+    const auto& corpus = safetyCorpus();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(corpus.engine.scan(corpus.commands[i++ % corpus.commands.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SafetyScan);
+
+// Parses each command and checks every simple command separately
+void BM_SafetyClassify(benchmark::State& state) {
+    const auto& corpus = safetyCorpus();
+    Latencies latencies(state);
+    size_t i = 0;
+    for (auto _ : state) {
+        auto start = Clock::now();
+        auto match = corpus.engine.classify(corpus.commands[i++ % corpus.commands.size()]);
+        latencies.add(start);
+        benchmark::DoNotOptimize(match);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SafetyClassify);
+
+// Dry-run ranking of a multi-candidate response ($PATH lookups are cached after the first round)
+void BM_RankCandidates(benchmark::State& state) {
+    WorkingDirectory cwd(fixtures().tree(100));
+    CommandValidator validator;
+    const std::vector<std::string> commands = {
+        "find ./test -name '*.pdf' -exec cp {} ./documents/ \\;",
+        "ls -la ./downloads | sort -k5 -n | tail -5",
+        "frobnicate ./missing/*.txt",
+        "tar czf backup.tgz ./documents && echo \"done",
+    };
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(validator.rank(commands));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(commands.size()));
+}
+BENCHMARK(BM_RankCandidates)->Unit(benchmark::kMicrosecond);
+
+// --- Query parsing ----------------------------------------------------------
+
+// The std::regex patterns QueryText replaced, built per call as they were
+void BM_DirectoryExtractionRegex(benchmark::State& state) {
+    const auto& queries = sampleQueries();
+    size_t i = 0;
+    for (auto _ : state) {
+        std::string query = queries[i++ % queries.size()];
+        std::transform(query.begin(), query.end(), query.begin(), ::tolower);
+        std::vector<std::string> found;
+        std::regex dir_pattern(R"(\b(test|dir1|dir2|documents?|downloads?|backup|temp|home|desktop)\b)");
+        for (std::sregex_iterator it(query.begin(), query.end(), dir_pattern), end; it != end; ++it) {
+            found.push_back((*it)[1]);
+        }
+        std::smatch match;
+        for (const char* keyword : {"in", "create", "to"}) {
+            std::regex after(std::string(keyword) + R"(\s+(?:the\s+)?(\w+)\s+(?:directory|dir|folder))");
+            if (std::regex_search(query, match, after)) {
+                found.push_back(match[1]);
+                break;
+            }
+        }
+        if (!found.empty()) {
+            std::regex nested(found.back() + R"(\s+(?:directory|dir|folder)?\s*in\s+(?:the\s+)?(\w+))");
+            if (std::regex_search(query, match, nested)) {
+                found.push_back(std::string(match[1]) + "/" + found.back());
+            }
+        }
+        benchmark::DoNotOptimize(found);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DirectoryExtractionRegex);
+
+void BM_DirectoryExtraction(benchmark::State& state) {
+    const auto& queries = sampleQueries();
+    size_t i = 0;
+    for (auto _ : state) {
+        QueryText query(queries[i++ % queries.size()]);
+        std::vector<std::string> found = query.mentionedDirectories();
+        std::string after = query.directoryAfter({"in", "create", "to"});
+        if (!after.empty()) found.push_back(after);
+        if (!found.empty()) found.push_back(query.nestedPath(found.back()));
+        benchmark::DoNotOptimize(found);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DirectoryExtraction);
+
+void BM_IntentMatch(benchmark::State& state) {
+    IntentEngine intents;
+    const auto& queries = sampleQueries();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(intents.match(queries[i++ % queries.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IntentMatch);
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // Progress lines and context dumps would swamp the report
+    Log::setLevel(LogLevel::Quiet);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,355 @@
+#include "mock_gemini_server.h"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef GANPI_MOCK_TLS
+#include <csignal>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#endif
+
+namespace ganpi {
+
+namespace {
+
+const char* const COMMAND_TEXT = "```bash\\nls -la\\n```";
+
+// Connection I/O, through TLS when ssl is set
+ssize_t receive(int fd, ssl_st* ssl, char* data, size_t size) {
+#ifdef GANPI_MOCK_TLS
+    if (ssl) {
+        int n = SSL_read(ssl, data, static_cast<int>(size));
+        return n > 0 ? n : -1;
+    }
+#endif
+    return recv(fd, data, size, 0);
+}
+
+bool writeAll(int fd, ssl_st* ssl, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+#ifdef GANPI_MOCK_TLS
+        if (ssl) {
+            int n = SSL_write(ssl, data.data() + sent, static_cast<int>(data.size() - sent));
+            if (n <= 0) return false;
+            sent += static_cast<size_t>(n);
+            continue;
+        }
+#endif
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+#ifdef GANPI_MOCK_TLS
+// Server context with a fresh P-256 key and a self-signed certificate for
+// 127.0.0.1, whose PEM goes to pem
+SSL_CTX* makeTlsContext(std::string& pem) {
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY_CTX* keygen = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    if (keygen && EVP_PKEY_keygen_init(keygen) > 0 &&
+        EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keygen, NID_X9_62_prime256v1) > 0) {
+        EVP_PKEY_keygen(keygen, &key);
+    }
+    EVP_PKEY_CTX_free(keygen);
+    X509* cert = X509_new();
+    SSL_CTX* context = SSL_CTX_new(TLS_server_method());
+    bool ok = key && cert && context;
+    if (ok) {
+        X509_set_version(cert, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                   reinterpret_cast<const unsigned char*>("127.0.0.1"), -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        // Clients match the address against the subjectAltName
+        X509V3_CTX v3;
+        X509V3_set_ctx_nodb(&v3);
+        X509V3_set_ctx(&v3, cert, cert, nullptr, nullptr, 0);
+        X509_EXTENSION* alt_name = X509V3_EXT_conf_nid(nullptr, &v3, NID_subject_alt_name, "IP:127.0.0.1");
+        ok = alt_name && X509_add_ext(cert, alt_name, -1) == 1 && X509_sign(cert, key, EVP_sha256()) > 0 &&
+             SSL_CTX_use_certificate(context, cert) == 1 && SSL_CTX_use_PrivateKey(context, key) == 1;
+        X509_EXTENSION_free(alt_name);
+    }
+    if (ok) {
+        BIO* out = BIO_new(BIO_s_mem());
+        char* data = nullptr;
+        if (out && PEM_write_bio_X509(out, cert) == 1) {
+            long length = BIO_get_mem_data(out, &data);
+            pem.assign(data, static_cast<size_t>(length));
+        }
+        BIO_free(out);
+        ok = !pem.empty();
+    }
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    if (!ok) {
+        SSL_CTX_free(context);
+        return nullptr;
+    }
+    return context;
+}
+#endif
+
+// Waits up to pause_ms for the peer to close its end; true if it did
+bool waitForHangup(int fd, long pause_ms) {
+    pollfd pfd{fd, POLLRDHUP, 0};
+    return poll(&pfd, 1, static_cast<int>(pause_ms)) > 0 && (pfd.revents & (POLLRDHUP | POLLHUP | POLLERR));
+}
+
+std::string httpResponse(const char* status, const char* content_type, const std::string& body) {
+    return std::string("HTTP/1.1 ") + status + "\r\nContent-Type: " + content_type +
+           "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+// Candidate JSON carrying text, which must already be JSON-escaped
+std::string candidateJson(const std::string& text) {
+    return "{\"candidates\":[{\"content\":{\"parts\":[{\"text\":\"" + text + "\"}]}}]}";
+}
+
+} // namespace
+
+MockGeminiServer::MockGeminiServer(bool tls) {
+    if (tls) {
+#ifdef GANPI_MOCK_TLS
+        tls_ = makeTlsContext(certificate_pem_);
+        if (!tls_) {
+            throw std::runtime_error("mock server: cannot create the TLS certificate");
+        }
+        // SSL_write has no MSG_NOSIGNAL; a client hanging up must not kill the process
+        std::signal(SIGPIPE, SIG_IGN);
+#else
+        throw std::runtime_error("mock server: built without TLS support");
+#endif
+    }
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("mock server: socket failed");
+    }
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;   // any free port
+    socklen_t length = sizeof(address);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listen_fd_, 1024) != 0 ||
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        close(listen_fd_);
+#ifdef GANPI_MOCK_TLS
+        SSL_CTX_free(tls_);
+#endif
+        throw std::runtime_error("mock server: cannot listen on 127.0.0.1");
+    }
+    port_ = ntohs(address.sin_port);
+    accept_thread_ = std::thread(&MockGeminiServer::acceptLoop, this);
+}
+
+MockGeminiServer::~MockGeminiServer() {
+    stopping_ = true;
+    shutdown(listen_fd_, SHUT_RDWR);
+    accept_thread_.join();
+    close(listen_fd_);
+
+    // Wake connection threads blocked in recv
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int fd : client_fds_) {
+            shutdown(fd, SHUT_RDWR);
+        }
+        threads.swap(client_threads_);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+#ifdef GANPI_MOCK_TLS
+    SSL_CTX_free(tls_);
+#endif
+}
+
+void MockGeminiServer::setLatency(std::chrono::milliseconds latency) {
+    latency_ms_ = static_cast<long>(latency.count());
+}
+
+void MockGeminiServer::setResponseBytes(size_t bytes) {
+    response_bytes_ = bytes;
+}
+
+void MockGeminiServer::setFailureEvery(int n, int status, int retry_after_s) {
+    failure_status_ = status;
+    retry_after_s_ = retry_after_s;
+    failure_every_ = n;
+}
+
+void MockGeminiServer::setSlowEvery(int n, std::chrono::milliseconds latency) {
+    slow_ms_ = static_cast<long>(latency.count());
+    slow_every_ = n;
+}
+
+void MockGeminiServer::setStreamPause(std::chrono::milliseconds pause) {
+    stream_pause_ms_ = static_cast<long>(pause.count());
+}
+
+std::string MockGeminiServer::lastRequestBody() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_body_;
+}
+
+std::string MockGeminiServer::baseUrl() const {
+    return std::string(tls_ ? "https" : "http") + "://127.0.0.1:" + std::to_string(port_) + "/v1beta";
+}
+
+void MockGeminiServer::acceptLoop() {
+    while (!stopping_) {
+        pollfd pfd{listen_fd_, POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0) {
+            continue;
+        }
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        ++connections_;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        client_fds_.push_back(fd);
+        client_threads_.emplace_back(&MockGeminiServer::serve, this, fd);
+    }
+}
+
+void MockGeminiServer::serve(int fd) {
+    std::string buffer;
+    char chunk[16384];
+    ssl_st* ssl = nullptr;
+#ifdef GANPI_MOCK_TLS
+    if (tls_) {
+        ssl = SSL_new(tls_);
+        if (!ssl || SSL_set_fd(ssl, fd) != 1 || SSL_accept(ssl) != 1) {
+            goto done;
+        }
+    }
+#endif
+    while (!stopping_) {
+        // Headers, then a Content-Length body
+        size_t header_end;
+        while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+            ssize_t n = receive(fd, ssl, chunk, sizeof(chunk));
+            if (n <= 0) goto done;
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+
+        size_t body_length = 0;
+        {
+            std::string headers = buffer.substr(0, header_end);
+            std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+            size_t field = headers.find("\r\ncontent-length:");
+            if (field != std::string::npos) {
+                body_length = static_cast<size_t>(std::strtoul(headers.c_str() + field + 17, nullptr, 10));
+            }
+        }
+        while (buffer.size() < header_end + 4 + body_length) {
+            ssize_t n = receive(fd, ssl, chunk, sizeof(chunk));
+            if (n <= 0) goto done;
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+
+        size_t method_end = buffer.find(' ');
+        size_t target_end = buffer.find(' ', method_end + 1);
+        std::string method = buffer.substr(0, method_end);
+        std::string target = buffer.substr(method_end + 1, target_end - method_end - 1);
+        if (method == "POST") {
+            std::lock_guard<std::mutex> lock(mutex_);
+            last_body_ = buffer.substr(header_end + 4, body_length);
+        }
+        buffer.erase(0, header_end + 4 + body_length);
+
+        std::string response;
+        if (method == "POST") {
+            long post = ++posts_;
+            long delay_ms = latency_ms_;
+            if (slow_every_ > 0 && post % slow_every_ == 0) {
+                delay_ms = slow_ms_;
+            }
+            if (delay_ms > 0 && waitForHangup(fd, delay_ms)) {
+                ++posts_abandoned_;
+                break;
+            }
+            if (failure_every_ > 0 && post % failure_every_ == 0) {
+                std::string status = std::to_string(failure_status_.load()) + " Injected";
+                response = "HTTP/1.1 " + status + "\r\nRetry-After: " + std::to_string(retry_after_s_.load()) +
+                           "\r\nContent-Type: application/json\r\nContent-Length: 2\r\n\r\n{}";
+            }
+        }
+        size_t first_part = 0;
+        if (response.empty()) {
+            response = respond(method, target, first_part);
+        }
+        if (first_part > 0 && stream_pause_ms_ > 0) {
+            if (!writeAll(fd, ssl, response.substr(0, first_part))) {
+                break;
+            }
+            if (waitForHangup(fd, stream_pause_ms_)) {
+                ++streams_cancelled_;
+                break;
+            }
+            response.erase(0, first_part);
+        }
+        if (!writeAll(fd, ssl, response)) {
+            break;
+        }
+    }
+done:
+#ifdef GANPI_MOCK_TLS
+    SSL_free(ssl);
+#endif
+    std::lock_guard<std::mutex> lock(mutex_);
+    client_fds_.erase(std::remove(client_fds_.begin(), client_fds_.end(), fd), client_fds_.end());
+    close(fd);
+}
+
+std::string MockGeminiServer::respond(const std::string& method, const std::string& target,
+                                      size_t& first_part) {
+    if (method == "HEAD") {
+        return "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+    }
+    if (method == "GET") {
+        return httpResponse("200 OK", "application/json", "{\"models\":[{\"name\":\"models/gemini-pro\"}]}");
+    }
+
+    // Pad the explanation after the command up to the configured size
+    std::string padding = "\\n\\nThis lists the directory.";
+    size_t target_bytes = response_bytes_;
+    if (target_bytes > padding.size() + 64) {
+        padding.append(target_bytes - padding.size() - 64, 'x');
+    }
+
+    if (target.find(":streamGenerateContent") != std::string::npos) {
+        std::string first = "data: " + candidateJson(COMMAND_TEXT) + "\r\n\r\n";
+        std::string body = first + "data: " + candidateJson(padding) + "\r\n\r\n";
+        std::string response = httpResponse("200 OK", "text/event-stream", body);
+        first_part = response.size() - body.size() + first.size();
+        return response;
+    }
+    return httpResponse("200 OK", "application/json", candidateJson(COMMAND_TEXT + padding));
+}
+
+} // namespace ganpi
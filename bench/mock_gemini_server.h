@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ssl_ctx_st;
+struct ssl_st;
+
+namespace ganpi {
+
+// In-process stand-in for the Gemini API on 127.0.0.1, one thread per
+// connection, HTTP/1.1 keep-alive. generateContent answers after the
+// configured latency with a fenced bash command padded to the configured
+// size; streamGenerateContent sends the command as the first SSE event and
+// the padding after it, optionally after a pause. GET /models and HEAD behave like the real API.
+// Faults can be injected on every nth POST: an error status with a
+// Retry-After, or a slow answer standing in for a latency tail.
+// In TLS mode it serves HTTPS with a self-signed certificate for 127.0.0.1
+// made at startup; that needs a build with GANPI_MOCK_TLS (OpenSSL).
+class MockGeminiServer {
+public:
+    explicit MockGeminiServer(bool tls = false);
+    ~MockGeminiServer();
+    MockGeminiServer(const MockGeminiServer&) = delete;
+    MockGeminiServer& operator=(const MockGeminiServer&) = delete;
+
+    void setLatency(std::chrono::milliseconds latency);
+    void setResponseBytes(size_t bytes);
+    // Every nth POST answers with status (e.g. 503) and a Retry-After of
+    // retry_after_s instead; n = 0 disables
+    void setFailureEvery(int n, int status, int retry_after_s = 0);
+    // Every nth POST waits this long instead of the latency; n = 0 disables
+    void setSlowEvery(int n, std::chrono::milliseconds latency);
+    // Pause between the first SSE event and the rest of a stream; a client
+    // that hangs up meanwhile is counted as having cancelled it
+    void setStreamPause(std::chrono::milliseconds pause);
+
+    // http://127.0.0.1:<port>/v1beta, https:// in TLS mode
+    std::string baseUrl() const;
+    // PEM of the TLS certificate, for the client's CA bundle; empty without TLS
+    const std::string& certificatePem() const { return certificate_pem_; }
+    long connectionsAccepted() const { return connections_; }
+    long postsReceived() const { return posts_; }
+    long streamsCancelled() const { return streams_cancelled_; }
+    // POSTs whose client hung up before the latency was over (a lost hedge)
+    long postsAbandoned() const { return posts_abandoned_; }
+    // Body of the most recent POST (the prompt, with its file system context)
+    std::string lastRequestBody();
+
+private:
+    int listen_fd_ = -1;
+    int port_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::atomic<long> latency_ms_{0};
+    std::atomic<size_t> response_bytes_{1024};
+    std::atomic<int> failure_every_{0};
+    std::atomic<int> failure_status_{503};
+    std::atomic<int> retry_after_s_{0};
+    std::atomic<int> slow_every_{0};
+    std::atomic<long> slow_ms_{0};
+    std::atomic<long> posts_{0};
+    std::atomic<long> stream_pause_ms_{0};
+    std::atomic<long> streams_cancelled_{0};
+    std::atomic<long> posts_abandoned_{0};
+    std::atomic<long> connections_{0};
+    std::thread accept_thread_;
+    ssl_ctx_st* tls_ = nullptr;
+    std::string certificate_pem_;
+
+    std::mutex mutex_;
+    std::string last_body_;
+    std::vector<int> client_fds_;
+    std::vector<std::thread> client_threads_;
+
+    void acceptLoop();
+    void serve(int fd);
+    // The whole response; a stream's first event ends at first_part (0: no split)
+    std::string respond(const std::string& method, const std::string& target, size_t& first_part);
+};
+
+} // namespace ganpi
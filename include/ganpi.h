@@ -1,14 +1,121 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iosfwd>
+#include <mutex>
+#include <new>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 #include <memory>
+#include <list>
 #include <map>
+#include <set>
+#include <unordered_map>
+
+// libganpi: the translation, context and execution engine behind the ganpi
+// CLI, usable from any C++17 program (link the libganpi CMake target).
+#define GANPI_VERSION_MAJOR 1
+#define GANPI_VERSION_MINOR 1
+#define GANPI_VERSION_PATCH 0
+
+// Exported classes of the shared library build; empty for the static one
+#if defined(GANPI_SHARED)
+#if defined(_WIN32)
+#if defined(GANPI_BUILDING_LIBRARY)
+#define GANPI_API __declspec(dllexport)
+#else
+#define GANPI_API __declspec(dllimport)
+#endif
+#else
+#define GANPI_API __attribute__((visibility("default")))
+#endif
+#else
+#define GANPI_API
+#endif
 
 namespace ganpi {
 
+// Output verbosity. Quiet keeps prompts, results and errors; normal adds
+// progress messages; verbose adds the context, request and response dumps;
+// trace adds libcurl's wire log.
+enum class LogLevel { Quiet = 0, Normal = 1, Verbose = 2, Trace = 3 };
+
+class GANPI_API Log {
+public:
+    static void setLevel(LogLevel level);
+    static LogLevel level();
+    static bool enabled(LogLevel level);
+    
+    // The log stream when the level is enabled, otherwise a stream that
+    // discards everything. Guard expensive arguments with enabled() instead.
+    static std::ostream& at(LogLevel level);
+    
+    // Send messages here instead of std::cout (nullptr restores std::cout);
+    // lets a host program embedding libganpi keep its stdout
+    static void setStream(std::ostream* stream);
+    
+    // "quiet", "normal", "verbose" or "trace"
+    static bool parseLevel(const std::string& name, LogLevel& level);
+    static const char* levelName(LogLevel level);
+    
+private:
+    static LogLevel level_;
+    static std::ostream* stream_;
+};
+
+// Per-request phase timings. Scopes add monotonic-clock durations to a
+// fixed array, so recording never allocates. Phases can overlap (the
+// connection warm-up runs alongside the context), so they need not sum to
+// the total.
+class GANPI_API Timings {
+public:
+    enum Phase {
+        Context, Prompt, Serialize, WarmupWait, Dns, Connect, Tls, Ttfb, Transfer, Backoff,
+        Parse, Extract, Validate, Confirm, Execute, Total, PhaseCount
+    };
+    
+    // Adds the time until it goes out of scope to a phase; null records nothing
+    class Scope {
+    public:
+        Scope(Timings* timings, Phase phase);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        
+    private:
+        Timings* timings_;
+        Phase phase_;
+        std::chrono::steady_clock::time_point start_;
+    };
+    
+    void reset();
+    void add(Phase phase, double ms) { ms_[phase] += ms; }
+    double get(Phase phase) const { return ms_[phase]; }
+    static const char* name(Phase phase);
+    
+    // Where the command came from: "api", "cache", "local" or "speculation"
+    void setSource(const char* source) { source_ = source; }
+    const char* source() const { return source_; }
+    
+    // Table for --timings, and a JSON object for the timings log
+    std::string report() const;
+    std::string json() const;
+    
+private:
+    double ms_[PhaseCount] = {};
+    const char* source_ = "api";
+};
+
 // Configuration class for API keys and settings
-class Config {
+class GANPI_API Config {
 public:
     static Config& getInstance();
     
@@ -18,6 +125,58 @@ public:
     void setModel(const std::string& model);
     std::string getModel() const;
     
+    void setApiBaseUrl(const std::string& url);
+    std::string getApiBaseUrl() const;
+    
+    void setStreaming(bool enabled);
+    bool getStreaming() const;
+    
+    // Path of the response cache file; empty disables the cache
+    void setResponseCachePath(const std::string& path);
+    std::string getResponseCachePath() const;
+    long getResponseCacheTtl() const;
+    size_t getResponseCacheEntries() const;
+    
+    size_t getBatchConcurrency() const;
+    
+    // Commands requested per API call and ranked by a dry run (1 = just one)
+    int getCandidateCount() const;
+    
+    // Approximate token cap for the file system context in prompts (0 = unlimited)
+    size_t getContextTokenBudget() const;
+    
+    // API call limits: connect timeout, deadline for the whole call
+    // including retries, retries after transient failures and their backoff
+    // base, and the delay before a hedged second request (0 = never, -1 =
+    // the p95 of recent calls)
+    long getConnectTimeoutMs() const;
+    long getRequestDeadlineMs() const;
+    int getMaxRetries() const;
+    long getRetryBaseMs() const;
+    long getHedgeAfterMs() const;
+    
+    // Typing pause after which interactive mode starts translating the
+    // partial request in the background (0 disables)
+    long getSpeculateAfterMs() const;
+    
+    // LOG_LEVEL from the config file; Normal when unset
+    LogLevel getLogLevel() const;
+    
+    // File that gets one JSON line of phase timings per request; empty for none
+    std::string getTimingsLogPath() const;
+    
+    // Minimum confidence for answering a request locally without the API (>1 disables)
+    double getLocalIntentThreshold() const;
+    
+    // Extra safety rules loaded on top of the built-in ones; empty for none
+    void setSafetyRulesPath(const std::string& path);
+    std::string getSafetyRulesPath() const;
+    
+    // Cached API key validation, stored by key hash in ~/.ganpi_keycheck.
+    // Returns 1 (valid), 0 (rejected) or -1 (unknown or expired).
+    int getCachedKeyValidation(const std::string& api_key) const;
+    void cacheKeyValidation(const std::string& api_key, bool valid);
+    
     bool loadFromFile(const std::string& filename = ".ganpi_config");
     void saveToFile(const std::string& filename = ".ganpi_config");
     
@@ -25,54 +184,784 @@ private:
     Config() = default;
     std::string gemini_api_key_;
     std::string model_ = "gemini-pro";
+    std::string api_base_url_;
+    bool streaming_ = false;
+    std::string response_cache_path_ = "~/.ganpi_cache";
+    long response_cache_ttl_ = 86400;
+    size_t response_cache_entries_ = 4096;
+    size_t batch_concurrency_ = 8;
+    int candidate_count_ = 1;
+    std::string safety_rules_path_;
+    double local_intent_threshold_ = 0.9;
+    size_t context_token_budget_ = 3000;
+    long connect_timeout_ms_ = 10000;
+    long request_deadline_ms_ = 30000;
+    int max_retries_ = 3;
+    long retry_base_ms_ = 500;
+    long hedge_after_ms_ = 0;
+    LogLevel log_level_ = LogLevel::Normal;
+    long speculate_after_ms_ = 0;
+    std::string timings_log_path_;
     static std::unique_ptr<Config> instance_;
 };
 
+// A query split once into words (\w runs), with matchers for the phrase
+// shapes the interpreters look for. Replaces std::regex objects that were
+// rebuilt on every call; the vocabularies are static tables.
+class GANPI_API QueryText {
+public:
+    explicit QueryText(const std::string& text);   // case-insensitive
+    
+    // Well-known directory names (test, dir1, downloads, ...) in order of mention
+    std::vector<std::string> mentionedDirectories(bool include_home = true) const;
+    
+    // "<keyword> [the] <name> directory|dir|folder" -> name, for the first keyword that fits
+    std::string directoryAfter(std::initializer_list<const char*> keywords) const;
+    
+    // "<dir_name> [directory|dir|folder] in [the] <parent>" -> "parent/dir_name", else dir_name
+    std::string nestedPath(const std::string& dir_name) const;
+    
+    // Whitespace-separated terms without surrounding punctuation, so names
+    // like "my-app", "v1.2" or "src/util" survive intact
+    const std::vector<std::string>& terms() const { return terms_; }
+    
+    // The \w words, lowercased
+    std::vector<std::string> words() const;
+    
+private:
+    struct Word {
+        std::string text;
+        bool spaced = false;    // only whitespace separates it from the previous word
+    };
+    std::vector<Word> words_;
+    std::vector<std::string> terms_;
+    
+    // Word i exists and directly follows word i - 1 across whitespace
+    bool follows(size_t i) const { return i < words_.size() && words_[i].spaced; }
+};
+
+// Directory names seen while scanning for context, looked up by the words of
+// a query so any directory the user names gets its listing expanded
+class GANPI_API DirectoryIndex {
+public:
+    // Index a path relative to the working directory under its lowercased base name
+    void add(const std::string& relative_path);
+    
+    // Paths of indexed directories the query names, in order of mention
+    std::vector<std::string> match(const QueryText& query, size_t max_results) const;
+    
+    bool contains(const std::string& name) const;
+    size_t size() const { return by_name_.size(); }
+    
+private:
+    std::unordered_map<std::string, std::vector<std::string>> by_name_;
+};
+
+// Metadata for one directory entry, captured with a single lstat
+struct DirectoryEntry {
+    std::string name;
+    bool is_directory = false;
+    bool is_regular = false;
+    unsigned int mode = 0;
+    unsigned long nlink = 0;
+    unsigned int uid = 0;
+    unsigned int gid = 0;
+    long long size = 0;
+    long long blocks = 0;   // 512-byte blocks
+    long long mtime = 0;
+    std::string link_target;
+};
+
+// Contents of one directory, sorted by name
+struct DirectoryListing {
+    std::string path;
+    bool exists = false;
+    std::vector<DirectoryEntry> entries;
+    uint64_t version = 0;   // changes whenever the entries do; unique per cache
+};
+
+// Directory listings keyed by absolute path and kept fresh with inotify, so
+// repeated queries in a session only re-stat entries that actually changed.
+// Without inotify every lookup falls back to a full read. At most
+// max_snapshots are kept; the least recently used one goes first, along
+// with its inotify watch.
+class GANPI_API DirectorySnapshotCache {
+public:
+    explicit DirectorySnapshotCache(size_t max_snapshots = 256);
+    ~DirectorySnapshotCache();
+    DirectorySnapshotCache(const DirectorySnapshotCache&) = delete;
+    DirectorySnapshotCache& operator=(const DirectorySnapshotCache&) = delete;
+    
+    // Listing for path (absolute, or relative to the working directory at the
+    // time of the call; snapshots are keyed by absolute path).
+    // The reference stays valid until the next call for the same path, or
+    // until max_snapshots - 1 other paths have been looked up since.
+    const DirectoryListing& get(const std::string& path);
+    
+    size_t fullScans() const { return full_scans_; }
+    size_t entriesRestated() const { return entries_restated_; }
+    size_t snapshots() const { return snapshots_.size(); }
+    size_t watches() const { return watches_.size(); }
+    
+private:
+    struct Snapshot {
+        DirectoryListing listing;
+        int watch = -1;
+        bool stale = true;
+        std::set<std::string> dirty;
+        std::list<std::string>::iterator recent;   // position in recent_
+    };
+    
+    int inotify_fd_ = -1;
+    size_t max_snapshots_;
+    std::map<std::string, Snapshot> snapshots_;
+    std::map<int, std::string> watches_;
+    std::list<std::string> recent_;   // snapshot keys, most recently used first
+    size_t full_scans_ = 0;
+    size_t entries_restated_ = 0;
+    uint64_t next_version_ = 0;
+    
+    std::string absolutePath(const std::string& path) const;
+    void watch(const std::string& key, Snapshot& snapshot);
+    void refreshDirty(const std::string& key, Snapshot& snapshot);
+    void markDirty(const std::string& key, const std::string& name);
+    void markParentDirty(const std::string& key);
+    void drainEvents();
+    void evictOldest();
+};
+
+// Builds the file system context sent with each prompt, in-process and
+// without spawning any child processes
+class GANPI_API ContextCollector {
+public:
+    struct Stats {
+        size_t raw_tokens = 0;      // estimated size of the uncompacted context
+        size_t tokens = 0;          // estimated size of what collect() returned
+        int level = 0;              // compaction level that was needed (0 = none)
+    };
+    
+    // Build the full context block for a natural language query
+    std::string collect(const std::string& query);
+    
+    // Read a single directory (excluding . and ..)
+    const DirectoryListing& list(const std::string& path);
+    
+    // Cap the context at about this many tokens (0 = unlimited). Over budget it
+    // is compacted step by step: sections repeating the listing are dropped,
+    // large listings are summarized, and as a last resort the text is cut.
+    void setTokenBudget(size_t tokens) { token_budget_ = tokens; }
+    const Stats& lastStats() const { return stats_; }
+    
+    // Rough token count, at about four bytes per token
+    static size_t estimateTokens(const std::string& text);
+    
+private:
+    // A rendered listing, reused while its listing version is unchanged
+    struct FormattedListing {
+        uint64_t version = 0;
+        long long rendered_at = 0;
+        std::string text;
+    };
+    
+    // What collect() reads before rendering: the working directory, the
+    // first tree lines and the directories the query mentions
+    struct Survey {
+        std::string cwd;
+        const DirectoryListing* current = nullptr;
+        std::vector<std::string> tree;
+        std::vector<std::pair<std::string, const DirectoryListing*>> mentioned;
+    };
+    
+    DirectorySnapshotCache snapshots_;
+    std::map<unsigned int, std::string> user_names_;
+    std::map<unsigned int, std::string> group_names_;
+    std::unordered_map<std::string, FormattedListing> formatted_;
+    size_t token_budget_ = 0;
+    Stats stats_;
+    
+    const std::string& userName(unsigned int uid);
+    const std::string& groupName(unsigned int gid);
+    Survey survey(const std::string& query);
+    std::string render(const Survey& found, int level);
+    std::string formatLongListing(const DirectoryListing& listing, size_t max_lines);
+    std::string summarizeListing(const DirectoryListing& listing, size_t top_n);
+    // The text stays valid until the next call
+    const std::string& formatListing(const DirectoryListing& listing, size_t max_lines, int level);
+};
+
+// Persistent natural language -> command cache in a memory-mapped file.
+// Entries are keyed by a hash of the model, the normalized query and the
+// file system context, expire after a TTL and are evicted LRU per bucket.
+// The file is flock'ed per operation so a team can share one cache.
+class GANPI_API ResponseCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t capacity = 0;
+    };
+    
+    ResponseCache(const std::string& path, long ttl_seconds = 86400, size_t max_entries = 4096);
+    ~ResponseCache();
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+    
+    bool isOpen() const;
+    const std::string& path() const { return path_; }
+    
+    static uint64_t makeKey(const std::string& model, const std::string& query,
+                            const std::string& context);
+    
+    bool lookup(uint64_t key, std::string& command);
+    void store(uint64_t key, const std::string& command);
+    void erase(uint64_t key);
+    Stats stats() const;
+    
+private:
+    std::string path_;
+    long ttl_seconds_;
+    int fd_ = -1;
+    void* mapping_ = nullptr;
+    size_t size_ = 0;
+    std::mutex mutex_;  // flock does not exclude threads sharing one descriptor
+};
+
+#ifndef _WIN32
+// Asynchronous HTTP engine: one loop thread drives every transfer through
+// curl_multi_socket_action (epoll on Linux), so many requests can be in
+// flight at once. Callbacks and futures are completed on the loop thread.
+class GANPI_API AsyncHttpEngine {
+public:
+    struct Response {
+        long status = 0;
+        std::string body;
+        std::string error;          // empty on transport success
+        long connections_opened = 0;
+    };
+    using Callback = std::function<void(Response)>;
+    // Returns a configured CURL* easy handle (as void* to keep curl out of this header)
+    using HandleFactory = std::function<void*()>;
+    
+    explicit AsyncHttpEngine(HandleFactory create_handle = nullptr, size_t max_in_flight = 64);
+    ~AsyncHttpEngine();
+    AsyncHttpEngine(const AsyncHttpEngine&) = delete;
+    AsyncHttpEngine& operator=(const AsyncHttpEngine&) = delete;
+    
+    // Queue a request (GET when body is empty); safe to call from any thread
+    void submit(const std::string& url, const std::string& body, Callback callback);
+    std::future<Response> submit(const std::string& url, const std::string& body);
+    
+    // Limit on concurrent transfers; further requests wait in a queue
+    void setMaxInFlight(size_t max_in_flight);
+    
+    // Requests queued or on the wire
+    size_t inFlight() const;
+    
+private:
+    struct Transfer;
+    
+    HandleFactory create_handle_;
+    size_t max_in_flight_;
+    void* multi_ = nullptr;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    bool has_deadline_ = false;   // libcurl timer, loop thread only
+    std::chrono::steady_clock::time_point deadline_;
+    bool stopping_ = false;
+    
+    mutable std::mutex mutex_;
+    std::deque<std::unique_ptr<Transfer>> queued_;
+    std::map<Transfer*, std::unique_ptr<Transfer>> active_;
+    std::vector<void*> idle_handles_;
+    std::thread loop_thread_;
+    
+    void loop();
+    void wake();
+    void startQueued();
+    void processCompletions();
+    void finish(Transfer& transfer, const std::string& error);
+    static int onSocket(void* easy, int socket, int what, void* userp, void* socketp);
+    static int onTimer(void* multi, long timeout_ms, void* userp);
+};
+#endif
+
+// Table-driven interpreter for common request shapes ("list files in test",
+// "find all pdfs", "start an http server"). Each match carries a confidence
+// so callers can decide when a local answer is good enough to skip the API.
+class GANPI_API IntentEngine {
+public:
+    struct Result {
+        std::string intent;         // empty when nothing matched
+        std::string command;
+        double confidence = 0.0;    // 0..1
+    };
+    
+    Result match(const std::string& natural_language) const;
+};
+
+// One generated command and what a dry run found wrong with it
+struct CommandCandidate {
+    std::string command;
+    bool parses = true;                         // valid shell syntax
+    std::vector<std::string> missing_programs;  // not a builtin, function or file in $PATH
+    std::vector<std::string> missing_paths;     // path arguments that do not exist
+    
+    bool viable() const { return parses && missing_programs.empty() && missing_paths.empty(); }
+};
+
+// Checks generated commands without running them: the line parses, every
+// program is a shell builtin, a function defined on the line or an
+// executable in $PATH, and the paths it reads from exist. Paths it creates
+// (mkdir, touch, the last argument of cp/mv, output redirections) are not
+// checked, and words with expansions are skipped.
+class GANPI_API CommandValidator {
+public:
+    CommandCandidate validate(const std::string& command) const;
+    
+    // Validate each command and order them best first: parsing ones, then
+    // fewer missing programs, then fewer missing paths. Ties keep the model's
+    // order; duplicates are dropped.
+    std::vector<CommandCandidate> rank(const std::vector<std::string>& commands) const;
+    
+private:
+    // $PATH lookups by program name, dropped when $PATH changes
+    mutable std::string path_env_;
+    mutable std::unordered_map<std::string, bool> resolved_;
+    
+    bool resolvable(const std::string& program) const;
+};
+
 // Gemini API client for natural language processing
-class GeminiClient {
+class GANPI_API GeminiClient {
 public:
     GeminiClient(const std::string& api_key);
+    ~GeminiClient();
+    
+    // Override the API endpoint (e.g. a local stand-in server)
+    void setBaseUrl(const std::string& base_url);
+    
+    // Use streamGenerateContent and stop reading once the command has arrived.
+    // Over HTTP/1.1 the cut-short response takes its connection with it, so
+    // every streamed request connects (and handshakes) anew.
+    void setStreaming(bool enabled);
+    
+#ifndef _WIN32
+    // Trust the certificates in this PEM file instead of the system store
+    // (e.g. a local stand-in server); call before the first request
+    void setCaBundle(const std::string& path);
+    
+    // Approximate token cap for the file system context (0 = unlimited)
+    void setContextTokenBudget(size_t tokens);
+#endif
+    
+    // Record the phases of interpretCommand here (nullptr disables)
+    void setTimings(Timings* timings);
+    
+    // Requests the IntentEngine matches with at least this confidence are
+    // answered locally (default 0.9; above 1 always asks the API)
+    void setLocalIntentThreshold(double threshold);
+    
+#ifndef _WIN32
+    // Consult this cache before calling the API (nullptr disables caching)
+    void setResponseCache(std::unique_ptr<ResponseCache> cache);
+    
+    // Skip response cache lookups; commands the user accepts still replace
+    // the cached ones, so this refreshes them (--no-cache)
+    void setCacheLookups(bool enabled);
+    
+    // The response cache only learns commands the user wanted. Key of the
+    // last interpretCommand answer (0 when it cannot be cached, e.g. a local
+    // intent); hand it back once the command ran, or was declined, which
+    // evicts a cached answer.
+    uint64_t lastCacheKey() const { return last_cache_key_; }
+    void acceptCommand(uint64_t key, const std::string& command);
+    void declineCommand(uint64_t key);
+    
+    // Ask for this many candidates per API call (candidateCount, default 1).
+    // Above 1 the candidates are dry-run validated and ranked, interpretCommand
+    // returns the best, and lastCandidates() holds them all. Such requests are
+    // not streamed, since the stream would be cut after the first candidate.
+    void setCandidateCount(int count);
+    
+    // Ranked candidates from the last interpretCommand that asked the API for
+    // more than one; empty after any other answer
+    const std::vector<CommandCandidate>& lastCandidates() const { return candidates_; }
+    
+    // Limits for interpretCommand and validateApiKey calls. Statuses 408,
+    // 429 and 5xx and dropped or refused connections are retried after
+    // full-jitter exponential backoff, never sooner than Retry-After, while
+    // the deadline allows. A hedged request is a second copy sent on its own
+    // connection when the first has not answered in time; the first complete
+    // answer wins.
+    struct RequestPolicy {
+        long connect_timeout_ms = 10000;
+        long deadline_ms = 30000;       // whole call, retries and backoff included
+        int max_retries = 3;            // at most 99
+        long retry_base_ms = 500;       // backoff ceiling, doubled per retry up to 8 s
+        long hedge_after_ms = 0;        // 0 = never hedge, -1 = p95 of recent calls
+    };
+    void setRequestPolicy(const RequestPolicy& policy);
+    
+    // Why the last API call failed, e.g. "HTTP 503 after 4 attempts"; empty
+    // when it got an answer
+    const std::string& lastError() const { return last_error_; }
+#endif
+    
+    // Number of TCP connections opened so far; stays flat while keep-alive works
+    long connectionsOpened() const;
+    
+    // HTTP status of the most recent API response (0 if none yet)
+    long lastHttpStatus() const;
+    
+    // True once the API has refused the key (401/403 or API_KEY_INVALID).
+    // Lets the first real request double as key validation.
+    bool apiKeyRejected() const;
     
     // Send natural language query to Gemini and get shell command
     std::string interpretCommand(const std::string& natural_language);
     
+    // Translate many queries with up to max_in_flight concurrent API calls.
+    // Commands are returned in submission order; failures are empty strings.
+    std::vector<std::string> interpretBatch(const std::vector<std::string>& queries,
+                                            size_t max_in_flight);
+    
     // Check if API key is valid
     bool validateApiKey();
     
+#ifndef _WIN32
+    // Non-blocking variants driven by the shared AsyncHttpEngine; any number
+    // may be outstanding at once
+    std::future<std::string> interpretCommandAsync(const std::string& natural_language);
+    std::future<bool> validateApiKeyAsync();
+    
+    // Warm the directory snapshot cache before a request arrives
+    void prefetchContext();
+    
+    // Start translating a request that may still change. interpretCommand
+    // reuses the result when it is asked for exactly this text; otherwise
+    // the result is discarded.
+    void speculate(const std::string& natural_language);
+    
+    // Errors of requests that finish on the engine thread (async calls and
+    // speculations) go here instead of std::cerr; called on that thread.
+    // An empty handler restores std::cerr.
+    void setErrorHandler(std::function<void(const std::string&)> handler);
+#endif
+    
 private:
     std::string api_key_;
     std::string model_;
+    std::string base_url_;
+    
+    // Persistent transport state, defined by each client implementation
+    struct HttpSession;
+    std::unique_ptr<HttpSession> http_;
+    std::atomic<long> connections_opened_{0};
+    std::atomic<long> last_status_{0};
+    std::atomic<bool> key_rejected_{false};
+    bool streaming_ = false;
+    IntentEngine intents_;
+    double local_intent_threshold_ = 0.9;
+    Timings* timings_ = nullptr;
+    
+#ifndef _WIN32
+    ContextCollector context_collector_;
+    std::unique_ptr<ResponseCache> response_cache_;
+    bool cache_lookups_ = true;
+    uint64_t last_cache_key_ = 0;
+    int candidate_count_ = 1;
+    CommandValidator validator_;
+    std::vector<CommandCandidate> candidates_;
+    RequestPolicy policy_;
+    std::string last_error_;
+    std::deque<double> latencies_;   // recent API call times, for automatic hedging
+    std::string speculation_query_;
+    std::shared_future<std::string> speculation_;
+    uint64_t speculation_cache_key_ = 0;
+    std::chrono::steady_clock::time_point speculation_started_;
+    std::mutex error_mutex_;
+    std::function<void(const std::string&)> error_handler_;
+    
+    // Connection warm-up on the persistent handle, overlapped with context
+    // collection. The handle belongs to the warm-up thread until it is joined.
+    std::thread warmup_thread_;
+    std::chrono::steady_clock::time_point last_transfer_;
+    std::atomic<bool> warmup_cancelled_{false};
+    double warmup_ms_ = 0.0;
+    Timings warmup_timings_;
+    // Declared last so its loop thread stops before the members it calls into
+    std::unique_ptr<AsyncHttpEngine> async_engine_;
+    
+    AsyncHttpEngine& asyncEngine();
+    void startWarmup();
+    // Abort the warm-up when the answer came without the API (cache hit)
+    void cancelWarmup();
+    void finishWarmup();
+    long hedgeDelayMs() const;
+    // One API call under policy_; setup prepares a CURL* (slot 1 is the
+    // hedge) and complete says a transfer cut short already has its answer.
+    // Returns the slot holding the answer, or -1 with last_error_ set.
+    int sendRequest(const std::function<void(void*, int)>& setup,
+                    const std::function<bool(int)>& complete, bool hedge);
+    // Returns the response cache key of the request (0 without a cache)
+    uint64_t submitTranslation(const std::string& natural_language,
+                               std::function<void(std::string)> done);
+    void reportError(const std::string& message);
+#endif
     
     std::string makeHttpRequest(const std::string& url, const std::string& data);
+    void recordResponseStatus(long status, const std::string& body);
+    std::string interpretBuffered(const std::string& request_body);
+    std::string interpretStreaming(const std::string& request_body);
     std::string buildPrompt(const std::string& user_input, const std::string& fs_context = "");
 };
 
+// Bump allocator for shell syntax trees. The first block lives inside the
+// arena itself, so parsing a typical command line never touches the heap.
+class GANPI_API ShellArena {
+public:
+    ShellArena() = default;
+    ~ShellArena();
+    ShellArena(const ShellArena&) = delete;
+    ShellArena& operator=(const ShellArena&) = delete;
+    
+    // Nodes must be trivially destructible; they are never destroyed individually
+    template <typename T>
+    T* make() { return new (allocate(sizeof(T), alignof(T))) T(); }
+    
+    std::string_view copy(std::string_view text);
+    
+private:
+    alignas(std::max_align_t) char inline_block_[2048];
+    std::vector<char*> blocks_;
+    char* current_ = inline_block_;
+    size_t remaining_ = sizeof(inline_block_);
+    
+    void* allocate(size_t size, size_t align);
+};
+
+struct ShellScript;
+
+// One shell word after quote removal. Text views point into the parsed
+// input or into the arena.
+struct ShellWord {
+    std::string_view text;
+    bool quoted = false;                    // some part was quoted or escaped
+    ShellScript* substitutions = nullptr;   // $(...) and `...` inside the word
+    ShellWord* next = nullptr;
+};
+
+struct ShellRedirect {
+    std::string_view op;                    // ">", ">>", "<", "2>", "&>", ...
+    ShellWord* target = nullptr;
+    ShellRedirect* next = nullptr;
+};
+
+struct ShellCommand {
+    enum class Kind { Simple, Subshell, Group, Function };
+    Kind kind = Kind::Simple;
+    ShellWord* words = nullptr;             // Simple: assignments, name and arguments
+    ShellRedirect* redirects = nullptr;
+    ShellScript* body = nullptr;            // Subshell, Group and Function
+    std::string_view name;                  // Function
+    ShellCommand* next = nullptr;           // next command in the pipeline
+};
+
+struct ShellPipeline {
+    ShellCommand* commands = nullptr;
+    bool negated = false;
+    std::string_view separator;             // what follows: ";", "&", "&&", "||" or empty
+    ShellPipeline* next = nullptr;
+};
+
+struct ShellScript {
+    ShellPipeline* pipelines = nullptr;
+    ShellScript* next = nullptr;            // sibling substitutions within one word
+};
+
+// Recursive-descent parser for POSIX shell command lines: words, quoting,
+// pipelines, lists, redirections, subshells, groups, functions and command
+// substitutions. Control-flow keywords are skipped rather than interpreted.
+class GANPI_API ShellParser {
+public:
+    explicit ShellParser(ShellArena& arena) : arena_(arena) {}
+    
+    // nullptr on a syntax error such as an unterminated quote; the input
+    // must outlive the returned tree
+    ShellScript* parse(std::string_view input);
+    
+    // The word naming the program a simple command runs: past leading
+    // assignments and wrappers with their options and operands (sudo -u
+    // USER, nice -n N, timeout DURATION, xargs -n N, ...). nullptr when
+    // there is none, as for the header of a for, select or case.
+    static const ShellWord* findProgram(const ShellWord* words);
+    
+    // NAME=value, as in the assignments before a command name
+    static bool isAssignment(std::string_view word);
+    
+private:
+    ShellArena& arena_;
+    std::string_view input_;
+    size_t pos_ = 0;
+    int depth_ = 0;
+    int case_depth_ = 0;                // open case ... esac, whose branches start with a pattern
+    bool case_opened_ = false;          // just parsed case WORD in
+    bool failed_ = false;
+    
+    ShellScript* parseScript(char terminator);
+    ShellPipeline* parsePipeline();
+    ShellCommand* parseCommand();
+    ShellWord* parseWord();
+    ShellRedirect* parseRedirect();
+    bool parseExpansion(std::string& text, ShellScript**& substitutions);
+    bool atRedirect() const;
+    bool atReservedWord(std::string_view word) const;
+    void skipBlanks();
+};
+
+// Classifies shell commands against safety rules. All rules are compiled into
+// one case-insensitive Aho-Corasick automaton, so matching is a single pass
+// however many rules there are.
+class GANPI_API SafetyEngine {
+public:
+    enum class Verdict { Safe = 0, Warn = 1, Block = 2 };
+    
+    struct Match {
+        Verdict verdict = Verdict::Safe;
+        std::string pattern;    // the most severe rule that matched
+    };
+    
+    // Starts with the built-in rules for this platform, already compiled
+    SafetyEngine();
+    
+    void addRule(Verdict verdict, const std::string& pattern);
+    
+    // Rule file lines are "block <pattern>" or "warn <pattern>"; # starts a comment.
+    // Recompiles on success; returns false if the file cannot be read.
+    bool loadRules(const std::string& path);
+    
+    void compile();
+    
+    // Parse the command and check each simple command on its own: rules must
+    // match whole words, and rm/dd/mkfs, sh -c, eval, block device redirects
+    // and self-calling functions get dedicated checks. Unparseable input falls
+    // back to scan().
+    Match classify(const std::string& command) const;
+    
+    // Plain substring match over the raw text
+    Match scan(const std::string& command) const;
+    
+    size_t ruleCount() const { return rules_.size(); }
+    
+private:
+    struct Rule {
+        Verdict verdict;
+        std::string pattern;
+    };
+    struct Walk;
+    
+    std::vector<Rule> rules_;
+    uint8_t classes_[256];              // byte -> alphabet class, 0 for bytes in no pattern
+    size_t alphabet_ = 1;
+    std::vector<int32_t> transitions_;  // state * alphabet_ + class -> next state
+    std::vector<int32_t> outputs_;      // state -> most severe rule ending here, or -1
+    std::vector<int32_t> own_;          // state -> most severe rule spelling exactly this state, or -1
+    std::vector<int32_t> dictionary_;   // state -> nearest proper suffix state with own_ set, or -1
+    std::vector<int32_t> depth_;        // state -> length of the text it spells
+    
+    void matchWords(const std::string& text, Match& match) const;
+    void classifyScript(const ShellScript* script, Walk& walk) const;
+    void classifyCommand(const ShellCommand* command, Walk& walk) const;
+    void classifyWords(const ShellWord* words, Walk& walk) const;
+    void classifyText(std::string_view text, Walk& walk) const;
+};
+
 // Command executor for running shell commands
-class CommandExecutor {
+class GANPI_API CommandExecutor {
 public:
     struct ExecutionResult {
         bool success;
-        std::string output;
+        std::string output;             // stdout and stderr interleaved as they arrived
         std::string error;
-        int exit_code;
+        int exit_code;                  // decoded exit status; 128+N when killed by signal N
+        bool output_streamed = false;   // output was already shown live
+        std::string stdout_output;      // the command's stdout on its own
+        std::string stderr_output;      // the command's stderr on its own (empty on Windows)
+        int term_signal = 0;            // signal that terminated the command, 0 if it exited
+        double wall_time_ms = 0.0;
+        double user_time_ms = 0.0;
+        double sys_time_ms = 0.0;
+        long max_rss_kb = 0;            // peak resident set size of the command
     };
     
+    // Relay command output to the terminal while it runs (default on)
+    void setStreamOutput(bool enabled);
+    
+    // Add rules from a file to the built-in safety rules
+    bool loadSafetyRules(const std::string& path);
+    
     // Execute a shell command and return results
     ExecutionResult execute(const std::string& command);
     
     // Execute command with confirmation prompt
     ExecutionResult executeWithConfirmation(const std::string& command);
     
+    // Execute without prompting; potentially dangerous commands are skipped
+    ExecutionResult executeUnattended(const std::string& command);
+    
 private:
+    bool stream_output_ = true;
+    SafetyEngine safety_;
+    
     std::string sanitizeCommand(const std::string& command);
     bool isDangerousCommand(const std::string& command);
 };
 
+// Raw-mode line editor for interactive mode: editing keys, history, and
+// callbacks while the user types. Falls back to std::getline when stdin is
+// not a terminal, and always on Windows.
+class GANPI_API LineEditor {
+public:
+    using Callback = std::function<void(const std::string&)>;
+    
+    LineEditor();
+    ~LineEditor();
+    LineEditor(const LineEditor&) = delete;
+    LineEditor& operator=(const LineEditor&) = delete;
+    
+    // Called with the line after the first keystroke of each line
+    void onFirstKey(Callback callback);
+    
+    // Called once the line has been idle for pause with text not yet reported
+    void onPause(std::chrono::milliseconds pause, Callback callback);
+    
+    // Show prompt and read a line; false at end of input
+    bool readLine(const std::string& prompt, std::string& line);
+    
+    // Print a message from any thread. While a line is being edited it goes
+    // above the prompt, which is then redrawn; otherwise to std::cerr.
+    void showMessage(const std::string& message);
+    
+private:
+    Callback on_first_key_;
+    Callback on_pause_;
+    std::chrono::milliseconds pause_{0};
+    std::vector<std::string> history_;
+    std::string input_;                 // keys read past the end of the last line
+    
+    std::mutex messages_mutex_;
+    std::vector<std::string> messages_; // waiting for the editor to print them
+    bool editing_ = false;              // readRaw owns the terminal
+    int wake_fds_[2] = {-1, -1};        // self-pipe that interrupts readRaw's poll
+    
+    bool readRaw(const std::string& prompt, std::string& line);
+};
+
 // Main GANPI application
-class GANPI {
+class GANPI_API GANPI {
 public:
     GANPI();
-    ~GANPI() = default;
+    ~GANPI();
     
     // Initialize the application
     bool initialize();
@@ -83,16 +972,92 @@ public:
     // Run in interactive mode
     void runInteractive();
     
+    // Translate and execute every request in a file (one per line).
+    // With auto_confirm, safe commands run without prompting.
+    void runBatch(const std::string& filename, bool auto_confirm);
+    
     // Show help information
     void showHelp();
     
+    // Override the config file's LOG_LEVEL; call before initialize()
+    void setLogLevel(LogLevel level);
+    
+    // Write one JSON object per request (command and execution result) to
+    // out instead of the human-readable report; implies quiet logging
+    void setJsonOutput(std::ostream* out);
+    
+    // Print a per-phase timing table after each request
+    void setShowTimings(bool enabled);
+    
+    // Skip response cache lookups (--no-cache); commands that run still
+    // refresh the cache. Call before initialize() or attachDaemon().
+    void setCacheLookups(bool enabled);
+    
+    // ganpid: after initialize(), translate requests from other ganpi
+    // invocations over a Unix domain socket until SIGINT/SIGTERM or a stop
+    // request, keeping connections, caches and directory snapshots warm.
+    // Requests are served one at a time. Not available on Windows.
+    int runDaemon(const std::string& socket_path);
+    
+    // Translate through the daemon on socket_path instead of a local client;
+    // call instead of initialize(). Confirmation and execution stay in this
+    // process. False when no daemon is listening.
+    bool attachDaemon(const std::string& socket_path);
+    
+    // Ask the daemon on socket_path to exit
+    static bool stopDaemon(const std::string& socket_path);
+    
+    // $GANPI_SOCKET, else $XDG_RUNTIME_DIR/ganpi.sock, else /tmp/ganpi-<uid>.sock
+    static std::string defaultSocketPath();
+    
 private:
     std::unique_ptr<GeminiClient> gemini_client_;
     std::unique_ptr<CommandExecutor> executor_;
     Config* config_;
+    bool key_validated_ = false;
+    bool log_level_set_ = false;
+    LogLevel log_level_ = LogLevel::Normal;
+    std::ostream* json_out_ = nullptr;
+    bool show_timings_ = false;
+    Timings timings_;
+    std::chrono::steady_clock::time_point request_started_;
+    int daemon_fd_ = -1;    // connection to ganpid, used by the next request
+    std::string daemon_socket_;
+    bool cache_lookups_ = true;
+    uint64_t cache_key_ = 0;    // response cache entry of the current request, 0 if none
+    std::vector<CommandCandidate> candidates_;  // ranked alternatives for the current request
+    
+    bool loadConfig();
+    void createExecutor();
+    void runRequest(const std::string& natural_language);
+    void reportTimings(const std::string& natural_language);
+    // result is null when nothing ran; error then says why
+    void printJsonResult(const std::string& request, const std::string& command,
+                         const CommandExecutor::ExecutionResult* result,
+                         const std::string& error = "Could not interpret the command");
     
+    // Turn the outcome of the last API call into a key validation result
+    bool checkApiKeyStatus();
     void printWelcomeMessage();
     void printCommandPreview(const std::string& command);
+    
+    // Cache the command once it ran, or evict the answer the user declined;
+    // through ganpid when it translated the request
+    void reportOutcome(const std::string& command, bool ran, bool via_daemon);
+    
+    // After the user declined command, offer the remaining candidates; false
+    // when there are none or the user picks none
+    bool chooseAlternative(std::string& command);
+    
+#ifndef _WIN32
+    // Serve one daemon client; true when it asked the daemon to stop
+    bool serveDaemonConnection(int fd);
+    // False when the daemon did not answer; error is its refusal, if any
+    bool translateWithDaemon(const std::string& natural_language, std::string& command,
+                             std::string& error);
+    // Tell ganpid whether the command it translated ran
+    void reportToDaemon(uint64_t key, const std::string& command, bool ran);
+#endif
 };
 
 } // namespace ganpi
@@ -0,0 +1,325 @@
+#include "ganpi.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <curl/curl.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace ganpi {
+
+// One request owned by the engine from submit() until its callback has run
+struct AsyncHttpEngine::Transfer {
+    std::string url;
+    std::string body;
+    std::string response;
+    Callback callback;
+    CURL* handle = nullptr;
+};
+
+namespace {
+
+size_t writeToString(void* contents, size_t size, size_t nmemb, std::string* s) {
+    size_t length = size * nmemb;
+    try {
+        s->append(static_cast<char*>(contents), length);
+        return length;
+    } catch (std::bad_alloc& e) {
+        return 0;
+    }
+}
+
+} // namespace
+
+AsyncHttpEngine::AsyncHttpEngine(HandleFactory create_handle, size_t max_in_flight)
+    : create_handle_(std::move(create_handle)), max_in_flight_(max_in_flight ? max_in_flight : 1) {
+    multi_ = curl_multi_init();
+    curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+#ifdef __linux__
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+    curl_multi_setopt(multi_, CURLMOPT_SOCKETFUNCTION, onSocket);
+    curl_multi_setopt(multi_, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(multi_, CURLMOPT_TIMERFUNCTION, onTimer);
+    curl_multi_setopt(multi_, CURLMOPT_TIMERDATA, this);
+#endif
+
+    loop_thread_ = std::thread(&AsyncHttpEngine::loop, this);
+}
+
+AsyncHttpEngine::~AsyncHttpEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake();
+    if (loop_thread_.joinable()) {
+        loop_thread_.join();
+    }
+
+    // Fail anything that never completed so no future is left hanging
+    for (auto& entry : active_) {
+        curl_multi_remove_handle(static_cast<CURLM*>(multi_), entry.second->handle);
+        finish(*entry.second, "engine shut down");
+        curl_easy_cleanup(entry.second->handle);
+    }
+    for (auto& transfer : queued_) {
+        finish(*transfer, "engine shut down");
+    }
+    for (void* handle : idle_handles_) {
+        curl_easy_cleanup(static_cast<CURL*>(handle));
+    }
+    curl_multi_cleanup(static_cast<CURLM*>(multi_));
+
+#ifdef __linux__
+    close(wake_fd_);
+    close(epoll_fd_);
+#endif
+}
+
+void AsyncHttpEngine::submit(const std::string& url, const std::string& body, Callback callback) {
+    auto transfer = std::make_unique<Transfer>();
+    transfer->url = url;
+    transfer->body = body;
+    transfer->callback = std::move(callback);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_.push_back(std::move(transfer));
+    }
+    wake();
+}
+
+std::future<AsyncHttpEngine::Response> AsyncHttpEngine::submit(const std::string& url,
+                                                               const std::string& body) {
+    auto promise = std::make_shared<std::promise<Response>>();
+    std::future<Response> future = promise->get_future();
+    submit(url, body, [promise](Response response) { promise->set_value(std::move(response)); });
+    return future;
+}
+
+void AsyncHttpEngine::setMaxInFlight(size_t max_in_flight) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        max_in_flight_ = max_in_flight ? max_in_flight : 1;
+    }
+    wake();
+}
+
+size_t AsyncHttpEngine::inFlight() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return active_.size() + queued_.size();
+}
+
+void AsyncHttpEngine::wake() {
+#ifdef __linux__
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+#else
+    curl_multi_wakeup(static_cast<CURLM*>(multi_));
+#endif
+}
+
+void AsyncHttpEngine::startQueued() {
+    std::vector<std::unique_ptr<Transfer>> failed;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!queued_.empty() && active_.size() < max_in_flight_) {
+        std::unique_ptr<Transfer> transfer = std::move(queued_.front());
+        queued_.pop_front();
+
+        CURL* handle = nullptr;
+        if (!idle_handles_.empty()) {
+            handle = static_cast<CURL*>(idle_handles_.back());
+            idle_handles_.pop_back();
+        } else if (create_handle_) {
+            handle = static_cast<CURL*>(create_handle_());
+        } else {
+            handle = curl_easy_init();
+        }
+        if (!handle) {
+            failed.push_back(std::move(transfer));
+            continue;
+        }
+
+        curl_easy_setopt(handle, CURLOPT_URL, transfer->url.c_str());
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, writeToString);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &transfer->response);
+        curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+        if (transfer->body.empty()) {
+            curl_easy_setopt(handle, CURLOPT_HTTPGET, 1L);
+        } else {
+            curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE, static_cast<long>(transfer->body.size()));
+            curl_easy_setopt(handle, CURLOPT_POSTFIELDS, transfer->body.c_str());
+        }
+        curl_easy_setopt(handle, CURLOPT_PRIVATE, transfer.get());
+        transfer->handle = handle;
+
+        curl_multi_add_handle(static_cast<CURLM*>(multi_), handle);
+        active_[transfer.get()] = std::move(transfer);
+    }
+    lock.unlock();
+
+    // Callbacks run without the lock so they may submit follow-up requests
+    for (auto& transfer : failed) {
+        finish(*transfer, "could not create a curl handle");
+    }
+}
+
+void AsyncHttpEngine::finish(Transfer& transfer, const std::string& error) {
+    Response response;
+    response.error = error;
+    response.body = std::move(transfer.response);
+    if (transfer.handle) {
+        curl_easy_getinfo(transfer.handle, CURLINFO_RESPONSE_CODE, &response.status);
+        curl_easy_getinfo(transfer.handle, CURLINFO_NUM_CONNECTS, &response.connections_opened);
+    }
+    if (transfer.callback) {
+        transfer.callback(std::move(response));
+    }
+}
+
+void AsyncHttpEngine::processCompletions() {
+    CURLM* multi = static_cast<CURLM*>(multi_);
+    int queued = 0;
+    while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+        CURL* handle = msg->easy_handle;
+        CURLcode result = msg->data.result;
+        Transfer* raw = nullptr;
+        curl_easy_getinfo(handle, CURLINFO_PRIVATE, &raw);
+        curl_multi_remove_handle(multi, handle);
+
+        std::unique_ptr<Transfer> transfer;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = active_.find(raw);
+            if (it != active_.end()) {
+                transfer = std::move(it->second);
+                active_.erase(it);
+            }
+        }
+        if (!transfer) {
+            continue;
+        }
+
+        finish(*transfer, result == CURLE_OK ? "" : curl_easy_strerror(result));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_handles_.push_back(handle);
+    }
+}
+
+#ifdef __linux__
+
+int AsyncHttpEngine::onSocket(void* /*easy*/, int socket, int what, void* userp, void* socketp) {
+    auto* engine = static_cast<AsyncHttpEngine*>(userp);
+    if (what == CURL_POLL_REMOVE) {
+        epoll_ctl(engine->epoll_fd_, EPOLL_CTL_DEL, socket, nullptr);
+        return 0;
+    }
+
+    struct epoll_event ev = {};
+    ev.data.fd = socket;
+    if (what == CURL_POLL_IN || what == CURL_POLL_INOUT) ev.events |= EPOLLIN;
+    if (what == CURL_POLL_OUT || what == CURL_POLL_INOUT) ev.events |= EPOLLOUT;
+
+    if (socketp) {
+        epoll_ctl(engine->epoll_fd_, EPOLL_CTL_MOD, socket, &ev);
+    } else {
+        epoll_ctl(engine->epoll_fd_, EPOLL_CTL_ADD, socket, &ev);
+        curl_multi_assign(static_cast<CURLM*>(engine->multi_), socket, engine);
+    }
+    return 0;
+}
+
+int AsyncHttpEngine::onTimer(void* /*multi*/, long timeout_ms, void* userp) {
+    auto* engine = static_cast<AsyncHttpEngine*>(userp);
+    engine->has_deadline_ = (timeout_ms >= 0);
+    engine->deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    return 0;
+}
+
+void AsyncHttpEngine::loop() {
+    CURLM* multi = static_cast<CURLM*>(multi_);
+    struct epoll_event events[64];
+    int running = 0;
+
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) break;
+        }
+        startQueued();
+
+        int wait_ms = 1000;
+        if (has_deadline_) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline_ - std::chrono::steady_clock::now()).count();
+            wait_ms = static_cast<int>(std::max<long long>(0, std::min<long long>(remaining, 1000)));
+        }
+        
+        int n = epoll_wait(epoll_fd_, events, 64, wait_ms);
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.fd == wake_fd_) {
+                uint64_t count;
+                ssize_t ignored = read(wake_fd_, &count, sizeof(count));
+                (void)ignored;
+                continue;
+            }
+            int flags = 0;
+            if (events[i].events & EPOLLIN) flags |= CURL_CSELECT_IN;
+            if (events[i].events & EPOLLOUT) flags |= CURL_CSELECT_OUT;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) flags |= CURL_CSELECT_ERR;
+            curl_multi_socket_action(multi, events[i].data.fd, flags, &running);
+        }
+        // Socket activity must not starve libcurl's own timers
+        if (has_deadline_ && std::chrono::steady_clock::now() >= deadline_) {
+            has_deadline_ = false;
+            curl_multi_socket_action(multi, CURL_SOCKET_TIMEOUT, 0, &running);
+        }
+        processCompletions();
+    }
+}
+
+#else
+
+int AsyncHttpEngine::onSocket(void*, int, int, void*, void*) {
+    return 0;
+}
+
+int AsyncHttpEngine::onTimer(void*, long, void*) {
+    return 0;
+}
+
+// Portable fallback: let libcurl poll its own sockets
+void AsyncHttpEngine::loop() {
+    CURLM* multi = static_cast<CURLM*>(multi_);
+    int running = 0;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) break;
+        }
+        startQueued();
+        curl_multi_perform(multi, &running);
+        processCompletions();
+        curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+    }
+}
+
+#endif
+
+} // namespace ganpi
@@ -4,9 +4,60 @@
 #include <sstream>
 #include <regex>
 #include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
 
 namespace ganpi {
 
+namespace {
+
+bool createPipe(int fds[2]) {
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    // Keep our read ends out of the child; the dup2'ed copies are unaffected
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+}
+
+double toMilliseconds(const struct timeval& tv) {
+    return static_cast<double>(tv.tv_sec) * 1000.0 + static_cast<double>(tv.tv_usec) / 1000.0;
+}
+
+void writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += n;
+        length -= static_cast<size_t>(n);
+    }
+}
+
+} // namespace
+
+void CommandExecutor::setStreamOutput(bool enabled) {
+    stream_output_ = enabled;
+}
+
+bool CommandExecutor::loadSafetyRules(const std::string& path) {
+    return safety_.loadRules(path);
+}
+
 CommandExecutor::ExecutionResult CommandExecutor::execute(const std::string& command) {
     ExecutionResult result;
     
@@ -27,30 +78,119 @@ CommandExecutor::ExecutionResult CommandExecutor::execute(const std::string& com
         return result;
     }
     
-    // Execute command and capture output
-    std::string full_command = sanitized_command + " 2>&1";
+    // Make sure everything printed so far appears before the command's output
+    std::cout.flush();
+    std::cerr.flush();
     
-    FILE* pipe = popen(full_command.c_str(), "r");
-    if (!pipe) {
+    int out_pipe[2];
+    int err_pipe[2];
+    if (!createPipe(out_pipe)) {
+        result.success = false;
+        result.error = "Failed to execute command";
+        result.exit_code = -1;
+        return result;
+    }
+    if (!createPipe(err_pipe)) {
+        close(out_pipe[0]);
+        close(out_pipe[1]);
         result.success = false;
         result.error = "Failed to execute command";
         result.exit_code = -1;
         return result;
     }
     
-    char buffer[128];
-    std::string output;
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        output += buffer;
+    // posix_spawn avoids copying our address space the way popen()'s fork does
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, err_pipe[1], STDERR_FILENO);
+    
+    const char* argv[] = {"sh", "-c", sanitized_command.c_str(), nullptr};
+    auto started = std::chrono::steady_clock::now();
+    pid_t pid = 0;
+    int spawn_error = posix_spawn(&pid, "/bin/sh", &actions, nullptr,
+                                  const_cast<char* const*>(argv), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(out_pipe[1]);
+    close(err_pipe[1]);
+    
+    if (spawn_error != 0) {
+        close(out_pipe[0]);
+        close(err_pipe[0]);
+        result.success = false;
+        result.error = "Failed to execute command";
+        result.exit_code = -1;
+        return result;
     }
     
-    int exit_code = pclose(pipe);
-    result.success = (exit_code == 0);
-    result.output = output;
-    result.exit_code = exit_code;
+    // Relay both pipes as data arrives, keeping each stream and their interleaving
+    std::string* captured[2] = {&result.stdout_output, &result.stderr_output};
+    std::vector<char> buffer(64 * 1024);
+    struct pollfd fds[2] = {{out_pipe[0], POLLIN, 0}, {err_pipe[0], POLLIN, 0}};
+    const int terminal_fds[2] = {STDOUT_FILENO, STDERR_FILENO};
+    int open_fds = 2;
+    
+    while (open_fds > 0) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < 2; ++i) {
+            if (fds[i].fd < 0 || !(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            ssize_t n = read(fds[i].fd, buffer.data(), buffer.size());
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                --open_fds;
+                continue;
+            }
+            captured[i]->append(buffer.data(), static_cast<size_t>(n));
+            result.output.append(buffer.data(), static_cast<size_t>(n));
+            if (stream_output_) {
+                writeAll(terminal_fds[i], buffer.data(), static_cast<size_t>(n));
+            }
+        }
+    }
+    
+    // wait4 reports the child's own resource usage alongside its status
+    int status = 0;
+    struct rusage usage;
+    std::memset(&usage, 0, sizeof(usage));
+    while (wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {
+    }
+    
+    result.wall_time_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - started).count();
+    result.user_time_ms = toMilliseconds(usage.ru_utime);
+    result.sys_time_ms = toMilliseconds(usage.ru_stime);
+#ifdef __APPLE__
+    result.max_rss_kb = usage.ru_maxrss / 1024;   // bytes on macOS
+#else
+    result.max_rss_kb = usage.ru_maxrss;
+#endif
+    
+    result.output_streamed = stream_output_;
+    
+    if (WIFSIGNALED(status)) {
+        result.term_signal = WTERMSIG(status);
+        result.exit_code = 128 + result.term_signal;
+        result.success = false;
+        const char* name = strsignal(result.term_signal);
+        result.error = "Command terminated by signal " + std::to_string(result.term_signal) +
+                       (name ? " (" + std::string(name) + ")" : "");
+        return result;
+    }
+    
+    result.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : status;
+    result.success = (result.exit_code == 0);
     
     if (!result.success) {
-        result.error = "Command failed with exit code " + std::to_string(exit_code);
+        result.error = "Command failed with exit code " + std::to_string(result.exit_code);
     }
     
     return result;
@@ -60,7 +200,8 @@ CommandExecutor::ExecutionResult CommandExecutor::executeWithConfirmation(const
     std::cout << "\n🔍 Command to execute:" << std::endl;
     std::cout << "   " << command << std::endl;
     
-    if (isDangerousCommand(command)) {
+    bool dangerous = isDangerousCommand(command);
+    if (dangerous) {
         std::cout << "\n⚠️  WARNING: This command may be potentially dangerous!" << std::endl;
         std::cout << "   Proceed? (y/N): ";
     } else {
@@ -72,14 +213,14 @@ CommandExecutor::ExecutionResult CommandExecutor::executeWithConfirmation(const
     
     // Default to yes for safe commands, no for dangerous commands
     bool should_execute = false;
-    if (isDangerousCommand(command)) {
+    if (dangerous) {
         should_execute = (response == "y" || response == "Y" || response == "yes");
     } else {
         should_execute = (response.empty() || response == "y" || response == "Y" || response == "yes");
     }
     
     if (should_execute) {
-        std::cout << "\n🚀 Executing..." << std::endl;
+        Log::at(LogLevel::Normal) << "\n🚀 Executing..." << std::endl;
         return execute(command);
     } else {
         std::cout << "❌ Command cancelled." << std::endl;
@@ -91,6 +232,17 @@ CommandExecutor::ExecutionResult CommandExecutor::executeWithConfirmation(const
     }
 }
 
+CommandExecutor::ExecutionResult CommandExecutor::executeUnattended(const std::string& command) {
+    if (isDangerousCommand(command)) {
+        ExecutionResult result;
+        result.success = false;
+        result.error = "Skipped: potentially dangerous command needs confirmation";
+        result.exit_code = -1;
+        return result;
+    }
+    return execute(command);
+}
+
 std::string CommandExecutor::sanitizeCommand(const std::string& command) {
     std::string sanitized = command;
     
@@ -105,57 +257,15 @@ std::string CommandExecutor::sanitizeCommand(const std::string& command) {
     }
     
     // Basic safety checks
-    std::vector<std::string> dangerous_patterns = {
-        "rm -rf /",
-        "sudo rm -rf",
-        "format",
-        "mkfs",
-        ":(){ :|:& };:",  // Fork bomb
-        "dd if=/dev/urandom",
-        "shutdown",
-        "reboot",
-        "halt",
-        "poweroff"
-    };
-    
-    std::string lower_command = sanitized;
-    std::transform(lower_command.begin(), lower_command.end(), lower_command.begin(), ::tolower);
-    
-    for (const auto& pattern : dangerous_patterns) {
-        if (lower_command.find(pattern) != std::string::npos) {
-            return ""; // Filter out dangerous commands
-        }
+    if (safety_.classify(sanitized).verdict == SafetyEngine::Verdict::Block) {
+        return ""; // Filter out dangerous commands
     }
     
     return sanitized;
 }
 
 bool CommandExecutor::isDangerousCommand(const std::string& command) {
-    std::vector<std::string> dangerous_keywords = {
-        "rm -rf",
-        "sudo",
-        "format",
-        "mkfs",
-        "dd",
-        "shutdown",
-        "reboot",
-        "halt",
-        "poweroff",
-        "chmod 777",
-        "chown root",
-        "passwd"
-    };
-    
-    std::string lower_command = command;
-    std::transform(lower_command.begin(), lower_command.end(), lower_command.begin(), ::tolower);
-    
-    for (const auto& keyword : dangerous_keywords) {
-        if (lower_command.find(keyword) != std::string::npos) {
-            return true;
-        }
-    }
-    
-    return false;
+    return safety_.classify(command).verdict != SafetyEngine::Verdict::Safe;
 }
 
 } // namespace ganpi
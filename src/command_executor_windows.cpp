@@ -2,9 +2,20 @@
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <chrono>
+#include <utility>
 
 namespace ganpi {
 
+// Output is collected and shown after the command exits, so there is nothing to relay
+void CommandExecutor::setStreamOutput(bool enabled) {
+    stream_output_ = enabled;
+}
+
+bool CommandExecutor::loadSafetyRules(const std::string& path) {
+    return safety_.loadRules(path);
+}
+
 CommandExecutor::ExecutionResult CommandExecutor::execute(const std::string& command) {
     ExecutionResult result;
     
@@ -28,6 +39,7 @@ CommandExecutor::ExecutionResult CommandExecutor::execute(const std::string& com
     // Execute command using Windows _popen
     std::string full_command = sanitized_command + " 2>&1";
     
+    auto started = std::chrono::steady_clock::now();
     FILE* pipe = _popen(full_command.c_str(), "r");
     if (!pipe) {
         result.success = false;
@@ -44,8 +56,12 @@ CommandExecutor::ExecutionResult CommandExecutor::execute(const std::string& com
     
     int exit_code = _pclose(pipe);
     result.success = (exit_code == 0);
-    result.output = output;
+    // _popen cannot keep the two streams apart; stdout_output gets both
+    result.stdout_output = output;
+    result.output = std::move(output);
     result.exit_code = exit_code;
+    result.wall_time_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - started).count();
     
     if (!result.success) {
         result.error = "Command failed with exit code " + std::to_string(exit_code);
@@ -58,7 +74,8 @@ CommandExecutor::ExecutionResult CommandExecutor::executeWithConfirmation(const
     std::cout << "\n🔍 Command to execute:" << std::endl;
     std::cout << "   " << command << std::endl;
     
-    if (isDangerousCommand(command)) {
+    bool dangerous = isDangerousCommand(command);
+    if (dangerous) {
         std::cout << "\n⚠️  WARNING: This command may be potentially dangerous!" << std::endl;
         std::cout << "   Proceed? (y/N): ";
     } else {
@@ -70,14 +87,14 @@ CommandExecutor::ExecutionResult CommandExecutor::executeWithConfirmation(const
     
     // Default to yes for safe commands, no for dangerous commands
     bool should_execute = false;
-    if (isDangerousCommand(command)) {
+    if (dangerous) {
         should_execute = (response == "y" || response == "Y" || response == "yes");
     } else {
         should_execute = (response.empty() || response == "y" || response == "Y" || response == "yes");
     }
     
     if (should_execute) {
-        std::cout << "\n🚀 Executing..." << std::endl;
+        Log::at(LogLevel::Normal) << "\n🚀 Executing..." << std::endl;
         return execute(command);
     } else {
         std::cout << "❌ Command cancelled." << std::endl;
@@ -89,6 +106,17 @@ CommandExecutor::ExecutionResult CommandExecutor::executeWithConfirmation(const
     }
 }
 
+CommandExecutor::ExecutionResult CommandExecutor::executeUnattended(const std::string& command) {
+    if (isDangerousCommand(command)) {
+        ExecutionResult result;
+        result.success = false;
+        result.error = "Skipped: potentially dangerous command needs confirmation";
+        result.exit_code = -1;
+        return result;
+    }
+    return execute(command);
+}
+
 std::string CommandExecutor::sanitizeCommand(const std::string& command) {
     std::string sanitized = command;
     
@@ -103,45 +131,15 @@ std::string CommandExecutor::sanitizeCommand(const std::string& command) {
     }
     
     // Basic safety checks
-    std::vector<std::string> dangerous_patterns = {
-        "format",
-        "del /s /q C:\\",
-        "rmdir /s /q C:\\",
-        "shutdown",
-        "reboot"
-    };
-    
-    std::string lower_command = sanitized;
-    std::transform(lower_command.begin(), lower_command.end(), lower_command.begin(), ::tolower);
-    
-    for (const auto& pattern : dangerous_patterns) {
-        if (lower_command.find(pattern) != std::string::npos) {
-            return ""; // Filter out dangerous commands
-        }
+    if (safety_.scan(sanitized).verdict == SafetyEngine::Verdict::Block) {
+        return ""; // Filter out dangerous commands
     }
     
     return sanitized;
 }
 
 bool CommandExecutor::isDangerousCommand(const std::string& command) {
-    std::vector<std::string> dangerous_keywords = {
-        "format",
-        "del /s",
-        "rmdir /s",
-        "shutdown",
-        "reboot"
-    };
-    
-    std::string lower_command = command;
-    std::transform(lower_command.begin(), lower_command.end(), lower_command.begin(), ::tolower);
-    
-    for (const auto& keyword : dangerous_keywords) {
-        if (lower_command.find(keyword) != std::string::npos) {
-            return true;
-        }
-    }
-    
-    return false;
+    return safety_.scan(command).verdict != SafetyEngine::Verdict::Safe;
 }
 
 } // namespace ganpi
@@ -0,0 +1,215 @@
+#include "ganpi.h"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ganpi {
+
+namespace {
+
+// Builtins and reserved words; the parser passes control-flow keywords through as words
+bool isBuiltin(std::string_view name) {
+    static const char* const builtins[] = {
+        ".", ":", "[", "[[", "alias", "bg", "break", "builtin", "case", "cd", "command",
+        "continue", "declare", "dirs", "do", "done", "echo", "elif", "else", "esac", "eval",
+        "exec", "exit", "export", "false", "fg", "fi", "for", "function", "getopts", "hash",
+        "history", "if", "in", "jobs", "kill", "let", "local", "popd", "printf", "pushd",
+        "pwd", "read", "readonly", "return", "select", "set", "shift", "shopt", "source",
+        "test", "then", "time", "times", "trap", "true", "type", "ulimit", "umask", "unalias",
+        "unset", "until", "wait", "while", "{", "}", "!"
+    };
+    for (const char* builtin : builtins) {
+        if (name == builtin) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Programs whose arguments are all created rather than read
+bool createsArguments(std::string_view program) {
+    return program == "mkdir" || program == "touch" || program == "tee";
+}
+
+// Programs whose last argument is a destination
+bool lastArgumentIsDestination(std::string_view program) {
+    return program == "cp" || program == "mv" || program == "ln" || program == "rsync" ||
+           program == "scp" || program == "install";
+}
+
+bool hasExpansion(std::string_view text) {
+    return text.find_first_of("$`") != std::string_view::npos;
+}
+
+// The part of a path argument that has to exist: the path itself, or for a
+// glob the directory before the first wildcard. Empty when there is nothing
+// to check (options, plain words, URLs).
+std::string existingPart(std::string_view text) {
+    if (text.empty() || text[0] == '-' || hasExpansion(text) ||
+        text.find("://") != std::string_view::npos) {
+        return "";
+    }
+    std::string path(text);
+    if (path[0] == '~' && (path.size() == 1 || path[1] == '/')) {
+        const char* home = getenv("HOME");
+        if (!home) return "";
+        path = std::string(home) + path.substr(1);
+    } else if (path.find('/') == std::string::npos) {
+        return "";   // a bare word may be a pattern, a name or a file; too ambiguous
+    }
+    size_t wildcard = path.find_first_of("*?[");
+    if (wildcard != std::string::npos) {
+        size_t slash = path.rfind('/', wildcard);
+        return slash == std::string::npos ? "" : (slash == 0 ? "/" : path.substr(0, slash));
+    }
+    return path;
+}
+
+bool pathExists(const std::string& path) {
+    struct stat info;
+    return lstat(path.c_str(), &info) == 0;
+}
+
+void addOnce(std::vector<std::string>& list, const std::string& value) {
+    if (std::find(list.begin(), list.end(), value) == list.end()) {
+        list.push_back(value);
+    }
+}
+
+} // namespace
+
+bool CommandValidator::resolvable(const std::string& program) const {
+    if (program.find('/') != std::string::npos) {
+        return access(program.c_str(), X_OK) == 0;
+    }
+
+    const char* path_env = getenv("PATH");
+    std::string path = path_env ? path_env : "";
+    if (path != path_env_) {
+        path_env_ = path;
+        resolved_.clear();
+    }
+    auto found = resolved_.find(program);
+    if (found != resolved_.end()) {
+        return found->second;
+    }
+
+    bool ok = false;
+    size_t start = 0;
+    while (!ok && start <= path.size()) {
+        size_t end = path.find(':', start);
+        if (end == std::string::npos) end = path.size();
+        std::string dir = end > start ? path.substr(start, end - start) : ".";
+        std::string candidate = dir + "/" + program;
+        struct stat info;
+        ok = stat(candidate.c_str(), &info) == 0 && S_ISREG(info.st_mode) &&
+             access(candidate.c_str(), X_OK) == 0;
+        start = end + 1;
+    }
+    resolved_[program] = ok;
+    return ok;
+}
+
+CommandCandidate CommandValidator::validate(const std::string& command) const {
+    CommandCandidate candidate;
+    candidate.command = command;
+
+    ShellArena arena;
+    ShellParser parser(arena);
+    const ShellScript* script = parser.parse(command);
+    if (!script) {
+        candidate.parses = false;
+        return candidate;
+    }
+
+    // Walk every simple command, including those inside groups and substitutions
+    std::vector<std::string_view> functions;
+    std::vector<const ShellScript*> scripts = {script};
+    while (!scripts.empty()) {
+        const ShellScript* current = scripts.back();
+        scripts.pop_back();
+        for (; current; current = current->next) {
+            for (const ShellPipeline* pipeline = current->pipelines; pipeline; pipeline = pipeline->next) {
+                for (const ShellCommand* cmd = pipeline->commands; cmd; cmd = cmd->next) {
+                    for (const ShellRedirect* redirect = cmd->redirects; redirect; redirect = redirect->next) {
+                        if (redirect->target && redirect->op.find('<') != std::string_view::npos &&
+                            redirect->op != "<<" && redirect->op != "<<<") {
+                            std::string path = existingPart(redirect->target->text);
+                            if (!path.empty() && !pathExists(path)) {
+                                addOnce(candidate.missing_paths, path);
+                            }
+                        }
+                    }
+                    if (cmd->kind != ShellCommand::Kind::Simple) {
+                        if (cmd->kind == ShellCommand::Kind::Function) {
+                            functions.push_back(cmd->name);
+                        }
+                        if (cmd->body) scripts.push_back(cmd->body);
+                        continue;
+                    }
+
+                    for (const ShellWord* word = cmd->words; word; word = word->next) {
+                        if (word->substitutions) scripts.push_back(word->substitutions);
+                    }
+                    // The program, past assignments and wrappers such as sudo -u USER
+                    const ShellWord* name = ShellParser::findProgram(cmd->words);
+                    if (!name || hasExpansion(name->text)) {
+                        continue;
+                    }
+
+                    std::string program(name->text);
+                    bool known = isBuiltin(program) ||
+                                 std::find(functions.begin(), functions.end(), name->text) != functions.end() ||
+                                 resolvable(program);
+                    if (!known) {
+                        addOnce(candidate.missing_programs, program);
+                    }
+
+                    std::string_view base = name->text.substr(name->text.find_last_of('/') + 1);
+                    if (createsArguments(base)) {
+                        continue;
+                    }
+                    const ShellWord* last = name->next;
+                    while (last && last->next) last = last->next;
+                    for (const ShellWord* arg = name->next; arg; arg = arg->next) {
+                        if (arg == last && arg != name->next && lastArgumentIsDestination(base)) {
+                            break;
+                        }
+                        std::string path = existingPart(arg->text);
+                        if (!path.empty() && !pathExists(path)) {
+                            addOnce(candidate.missing_paths, path);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return candidate;
+}
+
+std::vector<CommandCandidate> CommandValidator::rank(const std::vector<std::string>& commands) const {
+    std::vector<CommandCandidate> ranked;
+    for (const auto& command : commands) {
+        if (command.empty()) continue;
+        bool duplicate = std::any_of(ranked.begin(), ranked.end(), [&](const CommandCandidate& c) {
+            return c.command == command;
+        });
+        if (!duplicate) {
+            ranked.push_back(validate(command));
+        }
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const CommandCandidate& a, const CommandCandidate& b) {
+        if (a.parses != b.parses) return a.parses;
+        if (a.missing_programs.size() != b.missing_programs.size()) {
+            return a.missing_programs.size() < b.missing_programs.size();
+        }
+        return a.missing_paths.size() < b.missing_paths.size();
+    });
+    return ranked;
+}
+
+} // namespace ganpi
@@ -1,12 +1,58 @@
 #include "ganpi.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <cstdio>
 #include <cstdlib>
+#include <ctime>
+#include <vector>
 
 namespace ganpi {
 
+namespace {
+
+// How long a key validation result is trusted before the API is asked again
+const long KEY_VALID_SECONDS = 7 * 24 * 60 * 60;
+const long KEY_REJECTED_SECONDS = 60 * 60;
+const size_t MAX_KEY_VALIDATIONS = 16;
+
+const char* homeDirectory() {
+    const char* home = getenv("USERPROFILE"); // Windows
+    if (!home) {
+        home = getenv("HOME"); // Unix/Linux
+    }
+    return home;
+}
+
+std::string homePath(const std::string& filename) {
+    const char* home = homeDirectory();
+    return home ? std::string(home) + "/" + filename : filename;
+}
+
+// Expand a leading ~ to the home directory
+std::string expandHome(const std::string& path) {
+    const char* home = homeDirectory();
+    if (home && !path.empty() && path[0] == '~') {
+        return std::string(home) + path.substr(1);
+    }
+    return path;
+}
+
+// Hex FNV-1a of the key, so the key itself never lands in the validation file
+std::string hashApiKey(const std::string& api_key) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : api_key) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+} // namespace
+
 std::unique_ptr<Config> Config::instance_ = nullptr;
 
 Config& Config::getInstance() {
@@ -32,14 +78,145 @@ std::string Config::getModel() const {
     return model_;
 }
 
+void Config::setApiBaseUrl(const std::string& url) {
+    api_base_url_ = url;
+}
+
+std::string Config::getApiBaseUrl() const {
+    return api_base_url_;
+}
+
+void Config::setStreaming(bool enabled) {
+    streaming_ = enabled;
+}
+
+bool Config::getStreaming() const {
+    return streaming_;
+}
+
+void Config::setResponseCachePath(const std::string& path) {
+    response_cache_path_ = path;
+}
+
+std::string Config::getResponseCachePath() const {
+    return expandHome(response_cache_path_);
+}
+
+long Config::getResponseCacheTtl() const {
+    return response_cache_ttl_;
+}
+
+size_t Config::getResponseCacheEntries() const {
+    return response_cache_entries_;
+}
+
+size_t Config::getBatchConcurrency() const {
+    return batch_concurrency_;
+}
+
+int Config::getCandidateCount() const {
+    return candidate_count_;
+}
+
+double Config::getLocalIntentThreshold() const {
+    return local_intent_threshold_;
+}
+
+size_t Config::getContextTokenBudget() const {
+    return context_token_budget_;
+}
+
+long Config::getConnectTimeoutMs() const {
+    return connect_timeout_ms_;
+}
+
+long Config::getRequestDeadlineMs() const {
+    return request_deadline_ms_;
+}
+
+int Config::getMaxRetries() const {
+    return max_retries_;
+}
+
+long Config::getRetryBaseMs() const {
+    return retry_base_ms_;
+}
+
+long Config::getHedgeAfterMs() const {
+    return hedge_after_ms_;
+}
+
+LogLevel Config::getLogLevel() const {
+    return log_level_;
+}
+
+std::string Config::getTimingsLogPath() const {
+    return expandHome(timings_log_path_);
+}
+
+long Config::getSpeculateAfterMs() const {
+    return speculate_after_ms_;
+}
+
+void Config::setSafetyRulesPath(const std::string& path) {
+    safety_rules_path_ = path;
+}
+
+std::string Config::getSafetyRulesPath() const {
+    return expandHome(safety_rules_path_);
+}
+
+int Config::getCachedKeyValidation(const std::string& api_key) const {
+    std::ifstream file(homePath(".ganpi_keycheck"));
+    if (!file.is_open()) {
+        return -1;
+    }
+    
+    std::string hash = hashApiKey(api_key);
+    long long now = static_cast<long long>(time(nullptr));
+    std::string entry_hash;
+    int valid;
+    long long expires;
+    while (file >> entry_hash >> valid >> expires) {
+        if (entry_hash == hash) {
+            return expires > now ? valid : -1;
+        }
+    }
+    return -1;
+}
+
+void Config::cacheKeyValidation(const std::string& api_key, bool valid) {
+    std::string path = homePath(".ganpi_keycheck");
+    std::string hash = hashApiKey(api_key);
+    long long now = static_cast<long long>(time(nullptr));
+    
+    // Keep other keys' unexpired entries, newest first
+    std::vector<std::string> lines;
+    lines.push_back(hash + " " + (valid ? "1" : "0") + " " +
+                    std::to_string(now + (valid ? KEY_VALID_SECONDS : KEY_REJECTED_SECONDS)));
+    {
+        std::ifstream in(path);
+        std::string entry_hash;
+        int entry_valid;
+        long long expires;
+        while (in >> entry_hash >> entry_valid >> expires && lines.size() < MAX_KEY_VALIDATIONS) {
+            if (entry_hash != hash && expires > now) {
+                lines.push_back(entry_hash + " " + std::to_string(entry_valid) + " " + std::to_string(expires));
+            }
+        }
+    }
+    
+    std::ofstream out(path, std::ios::trunc);
+    for (const auto& line : lines) {
+        out << line << "\n";
+    }
+}
+
 bool Config::loadFromFile(const std::string& filename) {
     try {
         // Try to get home directory
         std::string config_path;
-        const char* home = getenv("USERPROFILE"); // Windows
-        if (!home) {
-            home = getenv("HOME"); // Unix/Linux
-        }
+        const char* home = homeDirectory();
         
         if (home && filename[0] == '.') {
             // If filename starts with . and we have home dir, use home directory
@@ -87,6 +264,47 @@ bool Config::loadFromFile(const std::string& filename) {
                     gemini_api_key_ = value;
                 } else if (key == "MODEL") {
                     model_ = value;
+                } else if (key == "API_BASE_URL") {
+                    api_base_url_ = value;
+                } else if (key == "STREAMING") {
+                    streaming_ = (value == "1" || value == "true" || value == "yes");
+                } else if (key == "RESPONSE_CACHE") {
+                    response_cache_path_ = (value == "off" || value == "none") ? "" : value;
+                } else if (key == "RESPONSE_CACHE_TTL") {
+                    response_cache_ttl_ = std::atol(value.c_str());
+                } else if (key == "RESPONSE_CACHE_ENTRIES") {
+                    response_cache_entries_ = static_cast<size_t>(std::atol(value.c_str()));
+                } else if (key == "BATCH_CONCURRENCY") {
+                    batch_concurrency_ = static_cast<size_t>(std::atol(value.c_str()));
+                } else if (key == "CANDIDATES") {
+                    // The API accepts 1 to 8 candidates per call
+                    candidate_count_ = std::min(std::max(std::atoi(value.c_str()), 1), 8);
+                } else if (key == "SAFETY_RULES") {
+                    safety_rules_path_ = value;
+                } else if (key == "LOCAL_INTENTS") {
+                    // "off" sends every request to the API
+                    local_intent_threshold_ = (value == "off" || value == "false") ? 2.0 : std::atof(value.c_str());
+                } else if (key == "CONTEXT_TOKEN_BUDGET") {
+                    // 0 sends the full context uncompacted
+                    context_token_budget_ = static_cast<size_t>(std::atol(value.c_str()));
+                } else if (key == "CONNECT_TIMEOUT_MS") {
+                    connect_timeout_ms_ = std::max(std::atol(value.c_str()), 1L);
+                } else if (key == "REQUEST_DEADLINE_MS") {
+                    request_deadline_ms_ = std::max(std::atol(value.c_str()), 1L);
+                } else if (key == "RETRIES") {
+                    max_retries_ = (value == "off") ? 0 : std::max(std::atoi(value.c_str()), 0);
+                } else if (key == "RETRY_BASE_MS") {
+                    retry_base_ms_ = std::max(std::atol(value.c_str()), 1L);
+                } else if (key == "HEDGE_AFTER_MS") {
+                    // "auto" hedges after the p95 of recent calls
+                    hedge_after_ms_ = (value == "off") ? 0 : (value == "auto") ? -1
+                                                       : std::max(std::atol(value.c_str()), 0L);
+                } else if (key == "SPECULATE_AFTER_MS") {
+                    speculate_after_ms_ = (value == "off") ? 0 : std::atol(value.c_str());
+                } else if (key == "TIMINGS_LOG") {
+                    timings_log_path_ = (value == "off" || value == "none") ? "" : value;
+                } else if (key == "LOG_LEVEL") {
+                    Log::parseLevel(value, log_level_);
                 }
             }
         }
@@ -101,10 +319,7 @@ bool Config::loadFromFile(const std::string& filename) {
 void Config::saveToFile(const std::string& filename) {
     // Try to get home directory
     std::string config_path;
-    const char* home = getenv("USERPROFILE"); // Windows
-    if (!home) {
-        home = getenv("HOME"); // Unix/Linux
-    }
+    const char* home = homeDirectory();
     
     if (home && filename[0] == '.') {
         // If filename starts with . and we have home dir, use home directory
@@ -119,11 +334,77 @@ void Config::saveToFile(const std::string& filename) {
         return;
     }
     
+    // Settings left at their defaults are not written
+    const Config defaults;
     file << "GEMINI_API_KEY=" << gemini_api_key_ << std::endl;
     file << "MODEL=" << model_ << std::endl;
+    if (!api_base_url_.empty()) {
+        file << "API_BASE_URL=" << api_base_url_ << std::endl;
+    }
+    if (streaming_) {
+        file << "STREAMING=true" << std::endl;
+    }
+    if (response_cache_path_ != defaults.response_cache_path_) {
+        file << "RESPONSE_CACHE=" << (response_cache_path_.empty() ? "off" : response_cache_path_) << std::endl;
+    }
+    if (response_cache_ttl_ != defaults.response_cache_ttl_) {
+        file << "RESPONSE_CACHE_TTL=" << response_cache_ttl_ << std::endl;
+    }
+    if (response_cache_entries_ != defaults.response_cache_entries_) {
+        file << "RESPONSE_CACHE_ENTRIES=" << response_cache_entries_ << std::endl;
+    }
+    if (batch_concurrency_ != defaults.batch_concurrency_) {
+        file << "BATCH_CONCURRENCY=" << batch_concurrency_ << std::endl;
+    }
+    if (candidate_count_ != defaults.candidate_count_) {
+        file << "CANDIDATES=" << candidate_count_ << std::endl;
+    }
+    if (!safety_rules_path_.empty()) {
+        file << "SAFETY_RULES=" << safety_rules_path_ << std::endl;
+    }
+    if (local_intent_threshold_ != defaults.local_intent_threshold_) {
+        file << "LOCAL_INTENTS=";
+        if (local_intent_threshold_ > 1.0) {
+            file << "off" << std::endl;
+        } else {
+            file << local_intent_threshold_ << std::endl;
+        }
+    }
+    if (context_token_budget_ != defaults.context_token_budget_) {
+        file << "CONTEXT_TOKEN_BUDGET=" << context_token_budget_ << std::endl;
+    }
+    if (connect_timeout_ms_ != defaults.connect_timeout_ms_) {
+        file << "CONNECT_TIMEOUT_MS=" << connect_timeout_ms_ << std::endl;
+    }
+    if (request_deadline_ms_ != defaults.request_deadline_ms_) {
+        file << "REQUEST_DEADLINE_MS=" << request_deadline_ms_ << std::endl;
+    }
+    if (max_retries_ != defaults.max_retries_) {
+        file << "RETRIES=" << max_retries_ << std::endl;
+    }
+    if (retry_base_ms_ != defaults.retry_base_ms_) {
+        file << "RETRY_BASE_MS=" << retry_base_ms_ << std::endl;
+    }
+    if (hedge_after_ms_ != defaults.hedge_after_ms_) {
+        file << "HEDGE_AFTER_MS=";
+        if (hedge_after_ms_ < 0) {
+            file << "auto" << std::endl;
+        } else {
+            file << hedge_after_ms_ << std::endl;
+        }
+    }
+    if (speculate_after_ms_ != defaults.speculate_after_ms_) {
+        file << "SPECULATE_AFTER_MS=" << speculate_after_ms_ << std::endl;
+    }
+    if (!timings_log_path_.empty()) {
+        file << "TIMINGS_LOG=" << timings_log_path_ << std::endl;
+    }
+    if (log_level_ != defaults.log_level_) {
+        file << "LOG_LEVEL=" << Log::levelName(log_level_) << std::endl;
+    }
     
     file.close();
-    std::cout << "   Config saved to: " << config_path << std::endl;
+    Log::at(LogLevel::Normal) << "   Config saved to: " << config_path << std::endl;
 }
 
 } // namespace ganpi
@@ -0,0 +1,424 @@
+#include "ganpi.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <set>
+
+#include <grp.h>
+#include <pwd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ganpi {
+
+namespace {
+
+// Maximum number of lines taken from the tree and mentioned-directory listings
+const size_t MAX_SECTION_LINES = 30;
+
+// First-level directories whose subdirectories are indexed for query matching
+const size_t MAX_INDEXED_DIRECTORIES = 64;
+
+// Directories the query names that get their listing expanded
+const size_t MAX_MENTIONED_DIRECTORIES = 8;
+
+// Compaction levels: 1 drops repeated sections, 2 summarizes listings longer
+// than SUMMARY_ENTRIES, 3 summarizes more aggressively and shortens the tree
+const int MAX_COMPACTION_LEVEL = 3;
+const size_t SUMMARY_ENTRIES[] = {0, 0, 50, 20};
+const size_t SUMMARY_TOP_N[] = {0, 0, 10, 5};
+const size_t TREE_LINES[] = {MAX_SECTION_LINES, MAX_SECTION_LINES, MAX_SECTION_LINES, 15};
+
+// Names listed in a summary before it switches to a count
+const size_t SUMMARY_NAMES = 20;
+
+// Six months, the cutoff `ls -l` uses to switch from time to year
+const long long RECENT_SECONDS = 6LL * 30 * 24 * 60 * 60;
+
+// How long a rendered listing is reused before its relative times are redone
+const long long FORMATTED_SECONDS = 60;
+
+// Rendered listings kept; all are dropped when there are more
+const size_t MAX_FORMATTED = 1024;
+
+std::string formatPermissions(unsigned int mode) {
+    std::string perms = "----------";
+    if (S_ISDIR(mode)) perms[0] = 'd';
+    else if (S_ISLNK(mode)) perms[0] = 'l';
+    else if (S_ISCHR(mode)) perms[0] = 'c';
+    else if (S_ISBLK(mode)) perms[0] = 'b';
+    else if (S_ISFIFO(mode)) perms[0] = 'p';
+    else if (S_ISSOCK(mode)) perms[0] = 's';
+
+    const char rwx[] = "rwxrwxrwx";
+    for (int i = 0; i < 9; ++i) {
+        if (mode & (1u << (8 - i))) {
+            perms[i + 1] = rwx[i];
+        }
+    }
+    if (mode & S_ISUID) perms[3] = (mode & S_IXUSR) ? 's' : 'S';
+    if (mode & S_ISGID) perms[6] = (mode & S_IXGRP) ? 's' : 'S';
+    if (mode & S_ISVTX) perms[9] = (mode & S_IXOTH) ? 't' : 'T';
+    return perms;
+}
+
+// Human readable size in the style of `ls -h` (rounded up, one decimal below 10)
+std::string formatHumanSize(long long bytes) {
+    if (bytes < 1024) {
+        return std::to_string(bytes);
+    }
+    const char units[] = "KMGTPE";
+    double value = static_cast<double>(bytes);
+    int unit = -1;
+    while (value >= 1024.0 && unit < 5) {
+        value /= 1024.0;
+        ++unit;
+    }
+    char buffer[32];
+    if (value < 10.0) {
+        value = std::ceil(value * 10.0) / 10.0;
+        if (value < 10.0) {
+            snprintf(buffer, sizeof(buffer), "%.1f%c", value, units[unit]);
+            return buffer;
+        }
+    }
+    snprintf(buffer, sizeof(buffer), "%.0f%c", std::ceil(value), units[unit]);
+    return buffer;
+}
+
+std::string formatTime(long long mtime, long long now) {
+    time_t t = static_cast<time_t>(mtime);
+    struct tm tm_buf;
+    localtime_r(&t, &tm_buf);
+    char buffer[32];
+    bool recent = (now - mtime) < RECENT_SECONDS && (mtime - now) < 60 * 60;
+    strftime(buffer, sizeof(buffer), recent ? "%b %e %H:%M" : "%b %e  %Y", &tm_buf);
+    return buffer;
+}
+
+std::string padLeft(const std::string& s, size_t width) {
+    return s.size() >= width ? s : std::string(width - s.size(), ' ') + s;
+}
+
+std::string padRight(const std::string& s, size_t width) {
+    return s.size() >= width ? s : s + std::string(width - s.size(), ' ');
+}
+
+std::string extensionOf(const std::string& name) {
+    size_t dot = name.find_last_of('.');
+    if (dot == std::string::npos || dot == 0 || dot + 1 == name.size()) {
+        return "(none)";
+    }
+    return name.substr(dot);
+}
+
+} // namespace
+
+// One collect() lists far fewer directories than the snapshot cache holds
+// (1 + MAX_INDEXED_DIRECTORIES + mentioned ones), so none of its listings
+// is evicted while still in use
+const DirectoryListing& ContextCollector::list(const std::string& path) {
+    return snapshots_.get(path);
+}
+
+const std::string& ContextCollector::userName(unsigned int uid) {
+    auto it = user_names_.find(uid);
+    if (it != user_names_.end()) {
+        return it->second;
+    }
+    struct passwd pwd;
+    struct passwd* found = nullptr;
+    char buffer[1024];
+    std::string name = std::to_string(uid);
+    if (getpwuid_r(uid, &pwd, buffer, sizeof(buffer), &found) == 0 && found) {
+        name = found->pw_name;
+    }
+    return user_names_.emplace(uid, name).first->second;
+}
+
+const std::string& ContextCollector::groupName(unsigned int gid) {
+    auto it = group_names_.find(gid);
+    if (it != group_names_.end()) {
+        return it->second;
+    }
+    struct group grp;
+    struct group* found = nullptr;
+    char buffer[1024];
+    std::string name = std::to_string(gid);
+    if (getgrgid_r(gid, &grp, buffer, sizeof(buffer), &found) == 0 && found) {
+        name = found->gr_name;
+    }
+    return group_names_.emplace(gid, name).first->second;
+}
+
+std::string ContextCollector::formatLongListing(const DirectoryListing& listing, size_t max_lines) {
+    // Same layout as `ls -lAh`: a total line followed by aligned columns
+    long long total_blocks = 0;
+    size_t links_w = 0, user_w = 0, group_w = 0, size_w = 0;
+    std::vector<std::string> sizes;
+    sizes.reserve(listing.entries.size());
+    for (const auto& entry : listing.entries) {
+        total_blocks += entry.blocks;
+        sizes.push_back(formatHumanSize(entry.size));
+        links_w = std::max(links_w, std::to_string(entry.nlink).size());
+        user_w = std::max(user_w, userName(entry.uid).size());
+        group_w = std::max(group_w, groupName(entry.gid).size());
+        size_w = std::max(size_w, sizes.back().size());
+    }
+
+    std::string out = "total " + formatHumanSize(total_blocks * 512) + "\n";
+    size_t lines = 1;
+    long long now = static_cast<long long>(time(nullptr));
+    for (size_t i = 0; i < listing.entries.size() && lines < max_lines; ++i, ++lines) {
+        const auto& entry = listing.entries[i];
+        out += formatPermissions(entry.mode) + " ";
+        out += padLeft(std::to_string(entry.nlink), links_w) + " ";
+        out += padRight(userName(entry.uid), user_w) + " ";
+        out += padRight(groupName(entry.gid), group_w) + " ";
+        out += padLeft(sizes[i], size_w) + " ";
+        out += formatTime(entry.mtime, now) + " ";
+        out += entry.name;
+        if (!entry.link_target.empty()) {
+            out += " -> " + entry.link_target;
+        }
+        out += "\n";
+    }
+    return out;
+}
+
+size_t ContextCollector::estimateTokens(const std::string& text) {
+    return (text.size() + 3) / 4;
+}
+
+std::string ContextCollector::summarizeListing(const DirectoryListing& listing, size_t top_n) {
+    // Counts by kind and extension, the directory names, then the newest and largest files
+    size_t directories = 0;
+    size_t files = 0;
+    long long total_size = 0;
+    std::map<std::string, size_t> by_extension;
+    std::string names;
+    size_t named = 0;
+    DirectoryListing newest;
+    DirectoryListing largest;
+    for (const auto& entry : listing.entries) {
+        if (entry.is_directory) {
+            ++directories;
+            if (named++ < SUMMARY_NAMES) names += (names.empty() ? "" : ", ") + entry.name + "/";
+            continue;
+        }
+        ++files;
+        total_size += entry.size;
+        ++by_extension[extensionOf(entry.name)];
+        newest.entries.push_back(entry);
+    }
+    largest.entries = newest.entries;
+
+    size_t n = std::min(top_n, newest.entries.size());
+    std::partial_sort(newest.entries.begin(), newest.entries.begin() + n, newest.entries.end(),
+                      [](const DirectoryEntry& a, const DirectoryEntry& b) { return a.mtime > b.mtime; });
+    newest.entries.resize(n);
+    std::partial_sort(largest.entries.begin(), largest.entries.begin() + n, largest.entries.end(),
+                      [](const DirectoryEntry& a, const DirectoryEntry& b) { return a.size > b.size; });
+    largest.entries.resize(n);
+
+    std::vector<std::pair<std::string, size_t>> extensions(by_extension.begin(), by_extension.end());
+    std::sort(extensions.begin(), extensions.end(),
+              [](const std::pair<std::string, size_t>& a, const std::pair<std::string, size_t>& b) {
+                  return a.second > b.second;
+              });
+
+    std::string out = "(summarized) " + std::to_string(listing.entries.size()) + " entries: " +
+                      std::to_string(directories) + " directories, " + std::to_string(files) +
+                      " files, " + formatHumanSize(total_size) + "\n";
+    if (!extensions.empty()) {
+        out += "By extension:";
+        for (size_t i = 0; i < extensions.size() && i < SUMMARY_NAMES; ++i) {
+            out += (i ? ", " : " ") + extensions[i].first + " " + std::to_string(extensions[i].second);
+        }
+        out += "\n";
+    }
+    if (directories > 0) {
+        out += "Directories: " + names;
+        if (directories > SUMMARY_NAMES) out += ", ... (" + std::to_string(directories - SUMMARY_NAMES) + " more)";
+        out += "\n";
+    }
+    if (n > 0) {
+        // Skip the "total" line formatLongListing starts with
+        std::string recent = formatLongListing(newest, n + 1);
+        std::string big = formatLongListing(largest, n + 1);
+        out += "Most recently modified:\n" + recent.substr(recent.find('\n') + 1);
+        out += "Largest:\n" + big.substr(big.find('\n') + 1);
+    }
+    return out;
+}
+
+const std::string& ContextCollector::formatListing(const DirectoryListing& listing, size_t max_lines, int level) {
+    // An unchanged listing renders the same, so warm queries reuse the text
+    std::string key = listing.path + '\0' + std::to_string(max_lines) + '\0' + std::to_string(level);
+    long long now = static_cast<long long>(time(nullptr));
+    auto it = formatted_.find(key);
+    if (it != formatted_.end() && it->second.version == listing.version &&
+        now - it->second.rendered_at < FORMATTED_SECONDS) {
+        return it->second.text;
+    }
+    
+    if (it == formatted_.end()) {
+        if (formatted_.size() >= MAX_FORMATTED) {
+            formatted_.clear();
+        }
+        it = formatted_.emplace(std::move(key), FormattedListing()).first;
+    }
+    if (SUMMARY_ENTRIES[level] > 0 && listing.entries.size() > SUMMARY_ENTRIES[level]) {
+        it->second.text = summarizeListing(listing, SUMMARY_TOP_N[level]);
+    } else {
+        it->second.text = formatLongListing(listing, max_lines);
+    }
+    it->second.version = listing.version;
+    it->second.rendered_at = now;
+    return it->second.text;
+}
+
+std::string ContextCollector::collect(const std::string& query) {
+    // Directories are read once; each compaction level only renders again
+    Survey found = survey(query);
+    std::string context = render(found, 0);
+    stats_ = Stats();
+    stats_.raw_tokens = estimateTokens(context);
+    stats_.tokens = stats_.raw_tokens;
+    if (token_budget_ == 0) {
+        return context;
+    }
+
+    for (int level = 1; level <= MAX_COMPACTION_LEVEL && stats_.tokens > token_budget_; ++level) {
+        context = render(found, level);
+        stats_.tokens = estimateTokens(context);
+        stats_.level = level;
+    }
+    if (stats_.tokens > token_budget_) {
+        // Still too big: keep the head, which holds the listing and tree
+        const std::string marker = "\n... (context truncated to fit the token budget)\n";
+        size_t keep = token_budget_ * 4 > marker.size() ? token_budget_ * 4 - marker.size() : 0;
+        context = context.substr(0, context.rfind('\n', keep) == std::string::npos ? keep : context.rfind('\n', keep)) + marker;
+        stats_.tokens = estimateTokens(context);
+        stats_.level = MAX_COMPACTION_LEVEL + 1;
+    }
+    return context;
+}
+
+ContextCollector::Survey ContextCollector::survey(const std::string& query) {
+    Survey found;
+
+    // Absolute paths spare the snapshot cache a getcwd per lookup
+    char cwd[4096];
+    std::string base;
+    if (getcwd(cwd, sizeof(cwd))) {
+        found.cwd = cwd;
+        base = found.cwd == "/" ? "" : found.cwd;
+    }
+    auto path = [&](const std::string& relative) {
+        return found.cwd.empty() ? relative : base + "/" + relative;
+    };
+
+    // One listing of the current directory feeds the structure, tree and file sections
+    found.current = &list(found.cwd.empty() ? "." : found.cwd);
+
+    // Directory tree, as `find . -maxdepth 2 -type d`. The same walk indexes
+    // directory names so the query can be matched against them.
+    DirectoryIndex index;
+    if (found.current->exists) {
+        size_t scanned = 0;
+        for (const auto& entry : found.current->entries) {
+            if (!entry.is_directory) continue;
+            index.add(entry.name);
+            if (found.tree.size() < MAX_SECTION_LINES) {
+                found.tree.push_back("./" + entry.name);
+            }
+            if (scanned++ >= MAX_INDEXED_DIRECTORIES) continue;
+            for (const auto& sub : list(path(entry.name)).entries) {
+                if (!sub.is_directory) continue;
+                index.add(entry.name + "/" + sub.name);
+                if (found.tree.size() < MAX_SECTION_LINES) {
+                    found.tree.push_back("./" + entry.name + "/" + sub.name);
+                }
+            }
+        }
+    }
+
+    // Directories the query names: anything in the index, paths given in full,
+    // and the usual suspects (downloads, backup, ...) so a missing one is reported
+    QueryText query_text(query);
+    std::vector<std::string> mentioned = index.match(query_text, MAX_MENTIONED_DIRECTORIES);
+    for (const auto& term : query_text.terms()) {
+        if (mentioned.size() >= MAX_MENTIONED_DIRECTORIES) break;
+        if (term.find('/') != std::string::npos && term[0] != '/' && term.find("..") == std::string::npos &&
+            std::find(mentioned.begin(), mentioned.end(), term) == mentioned.end() && list(path(term)).exists) {
+            mentioned.push_back(term);
+        }
+    }
+    for (const auto& name : query_text.mentionedDirectories()) {
+        if (mentioned.size() >= MAX_MENTIONED_DIRECTORIES) break;
+        if (!index.contains(name) && std::find(mentioned.begin(), mentioned.end(), name) == mentioned.end()) {
+            mentioned.push_back(name);
+        }
+    }
+    std::sort(mentioned.begin(), mentioned.end());
+    for (const auto& dir : mentioned) {
+        found.mentioned.emplace_back(dir, &list(path(dir)));
+    }
+    return found;
+}
+
+std::string ContextCollector::render(const Survey& found, int level) {
+    std::string context = "\n=== FILE SYSTEM CONTEXT ===\n";
+    if (!found.cwd.empty()) {
+        context += "Current directory: " + found.cwd + "\n";
+    }
+
+    const DirectoryListing& current = *found.current;
+    bool current_summarized = SUMMARY_ENTRIES[level] > 0 && current.entries.size() > SUMMARY_ENTRIES[level];
+
+    // ALWAYS show current directory structure first
+    context += "\n--- Current Directory Structure ---\n";
+    if (current.exists) {
+        context += formatListing(current, static_cast<size_t>(-1), level);
+    }
+
+    context += "\n--- Directory Tree (2 levels) ---\n";
+    if (current.exists) {
+        context += ".\n";
+        for (size_t i = 0; i < found.tree.size() && i + 1 < TREE_LINES[level]; ++i) {
+            context += found.tree[i] + "\n";
+        }
+    }
+    
+    // List all files in current directory (non-hidden). Once compacting, the
+    // structure section above already carries them.
+    context += "\n--- All Files in Current Directory ---\n";
+    if (level == 0) {
+        for (const auto& entry : current.entries) {
+            if (entry.is_regular) {
+                context.append("./").append(entry.name).push_back('\n');
+            }
+        }
+    } else {
+        context += current_summarized ? "(see summary above)\n" : "(see listing above)\n";
+    }
+    
+    // List files in specifically mentioned directories
+    if (!found.mentioned.empty()) {
+        context += "\n--- Mentioned Directories ---\n";
+        for (const auto& dir : found.mentioned) {
+            if (dir.second->exists) {
+                context += "\nContents of " + dir.first + "/:\n" + formatListing(*dir.second, MAX_SECTION_LINES, level);
+            } else {
+                context += "\n" + dir.first + "/ does not exist or is empty\n";
+            }
+        }
+    }
+    
+    context += "\n===========================\n";
+    return context;
+}
+
+} // namespace ganpi
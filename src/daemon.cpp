@@ -0,0 +1,418 @@
+#include "ganpi.h"
+#include <nlohmann/json.hpp>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace ganpi {
+
+namespace {
+
+using json = nlohmann::json;
+
+// Longest request line accepted from a client
+const size_t MAX_LINE = 1 << 20;
+
+// A client that connects but never sends is dropped after this long
+const int READ_TIMEOUT_SECONDS = 5;
+
+volatile sig_atomic_t stop_requested = 0;
+
+void onStopSignal(int) {
+    stop_requested = 1;
+}
+
+bool fillAddress(const std::string& path, sockaddr_un& address) {
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+int connectTo(const std::string& path) {
+    sockaddr_un address;
+    if (!fillAddress(path, address)) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool writeLine(int fd, const std::string& line) {
+    std::string data = line + "\n";
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool readLine(int fd, std::string& line) {
+    line.clear();
+    char buffer[4096];
+    while (line.size() < MAX_LINE) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        line.append(buffer, static_cast<size_t>(n));
+        size_t newline = line.find('\n');
+        if (newline != std::string::npos) {
+            line.erase(newline);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Only the user running the daemon may use it: it holds their API key
+bool peerIsSameUser(int fd) {
+#if defined(SO_PEERCRED)
+    ucred credentials{};
+    socklen_t length = sizeof(credentials);
+    return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0 &&
+           credentials.uid == getuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    return getpeereid(fd, &uid, &gid) == 0 && uid == getuid();
+#endif
+}
+
+// A string member of a message; fallback when it is missing or not a string
+std::string stringField(const json& message, const char* name, const std::string& fallback = "") {
+    auto field = message.find(name);
+    return field != message.end() && field->is_string() ? field->get<std::string>() : fallback;
+}
+
+std::vector<std::string> stringList(const json& message, const char* name) {
+    std::vector<std::string> list;
+    auto field = message.find(name);
+    if (field != message.end() && field->is_array()) {
+        for (const auto& item : *field) {
+            if (item.is_string()) list.push_back(item.get<std::string>());
+        }
+    }
+    return list;
+}
+
+// Timings::setSource keeps the pointer, so reported sources map to literals
+const char* sourceLiteral(const std::string& source) {
+    for (const char* known : {"api", "cache", "local", "speculation"}) {
+        if (source == known) return known;
+    }
+    return "daemon";
+}
+
+} // namespace
+
+std::string GANPI::defaultSocketPath() {
+    if (const char* path = getenv("GANPI_SOCKET")) {
+        return path;
+    }
+    if (const char* runtime = getenv("XDG_RUNTIME_DIR")) {
+        return std::string(runtime) + "/ganpi.sock";
+    }
+    return "/tmp/ganpi-" + std::to_string(getuid()) + ".sock";
+}
+
+int GANPI::runDaemon(const std::string& socket_path) {
+    if (!gemini_client_ || !executor_) {
+        std::cout << "❌ GANPI not properly initialized." << std::endl;
+        return 1;
+    }
+
+    sockaddr_un address;
+    if (!fillAddress(socket_path, address)) {
+        std::cout << "❌ Invalid socket path: " << socket_path << std::endl;
+        return 1;
+    }
+    int existing = connectTo(socket_path);
+    if (existing >= 0) {
+        close(existing);
+        std::cout << "❌ ganpid is already running on " << socket_path << std::endl;
+        return 1;
+    }
+    unlink(socket_path.c_str());   // left behind by a daemon that did not exit cleanly
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    mode_t saved_umask = umask(0177);
+    bool listening = listen_fd >= 0 &&
+                     bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 &&
+                     listen(listen_fd, 16) == 0;
+    umask(saved_umask);
+    if (!listening) {
+        std::cout << "❌ Cannot listen on " << socket_path << ": " << strerror(errno) << std::endl;
+        if (listen_fd >= 0) close(listen_fd);
+        return 1;
+    }
+
+    // No SA_RESTART, so a signal interrupts accept() and the loop can exit
+    struct sigaction action{};
+    struct sigaction saved_int{}, saved_term{};
+    action.sa_handler = onStopSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &saved_int);
+    sigaction(SIGTERM, &action, &saved_term);
+    stop_requested = 0;
+
+    char home_dir[PATH_MAX];
+    if (!getcwd(home_dir, sizeof(home_dir))) {
+        strcpy(home_dir, "/");
+    }
+
+    std::cout << "🛰️  ganpid listening on " << socket_path << std::endl;
+    bool stop = false;
+    while (!stop && !stop_requested) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            std::cout << "❌ accept failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        if (!peerIsSameUser(fd)) {
+            close(fd);
+            continue;
+        }
+        timeval timeout{READ_TIMEOUT_SECONDS, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        try {
+            stop = serveDaemonConnection(fd);
+        } catch (const std::exception& e) {
+            // One bad request must not take the daemon down
+            writeLine(fd, json{{"error", std::string("Request failed: ") + e.what()}}.dump());
+            std::cout << "⚠️  Request failed: " << e.what() << std::endl;
+        }
+        close(fd);
+        // Do not keep the last client's directory busy
+        if (chdir(home_dir) != 0) {
+            std::cout << "⚠️  Could not return to " << home_dir << std::endl;
+        }
+    }
+
+    sigaction(SIGINT, &saved_int, nullptr);
+    sigaction(SIGTERM, &saved_term, nullptr);
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    std::cout << "👋 ganpid stopped" << std::endl;
+    return 0;
+}
+
+bool GANPI::serveDaemonConnection(int fd) {
+    std::string line;
+    if (!readLine(fd, line)) {
+        return false;
+    }
+    json request = json::parse(line, nullptr, false);
+    if (request.is_discarded() || !request.is_object()) {
+        writeLine(fd, json{{"error", "Malformed request"}}.dump());
+        return false;
+    }
+
+    std::string op = stringField(request, "op", "translate");
+    if (op == "stop") {
+        writeLine(fd, json{{"stopping", true}}.dump());
+        return true;
+    }
+    if (op == "ping") {
+        writeLine(fd, json{{"pid", static_cast<long>(getpid())}}.dump());
+        return false;
+    }
+    if (op == "accept" || op == "decline") {
+        // The client ran or declined a command this daemon translated
+        auto key = request.find("key");
+        if (key == request.end() || !key->is_number_unsigned()) {
+            writeLine(fd, json{{"error", "Malformed request: key must be a number"}}.dump());
+            return false;
+        }
+        if (op == "accept") {
+            gemini_client_->acceptCommand(key->get<uint64_t>(), stringField(request, "command"));
+        } else {
+            gemini_client_->declineCommand(key->get<uint64_t>());
+        }
+        writeLine(fd, json{{"ok", true}}.dump());
+        return false;
+    }
+
+    // The context has to describe the client's directory, not the daemon's
+    std::string cwd = stringField(request, "cwd");
+    std::string natural_language = stringField(request, "request");
+    if (cwd.empty() || natural_language.empty()) {
+        writeLine(fd, json{{"error", "Malformed request: cwd and request must be strings"}}.dump());
+        return false;
+    }
+    if (chdir(cwd.c_str()) != 0) {
+        writeLine(fd, json{{"error", "Cannot enter " + cwd}}.dump());
+        return false;
+    }
+
+    // --no-cache on the client side skips the lookup for this request only
+    auto refresh = request.find("refresh");
+    bool lookups = cache_lookups_ && !(refresh != request.end() && refresh->is_boolean() && refresh->get<bool>());
+
+    timings_.reset();
+    auto start = std::chrono::steady_clock::now();
+    gemini_client_->setCacheLookups(lookups);
+    std::string command = gemini_client_->interpretCommand(natural_language);
+    gemini_client_->setCacheLookups(cache_lookups_);
+    timings_.add(Timings::Total, std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count());
+
+    json reply;
+    if (!checkApiKeyStatus()) {
+        reply["error"] = "Invalid API key. Please check your Gemini API key.";
+    } else if (command.empty() && !gemini_client_->lastError().empty()) {
+        reply["error"] = "Gemini API request failed: " + gemini_client_->lastError();
+    } else {
+        reply["command"] = command;
+        if (gemini_client_->lastCacheKey() != 0) {
+            reply["cache_key"] = gemini_client_->lastCacheKey();
+        }
+        // Ranked alternatives, validated against the client's directory
+        const auto& candidates = gemini_client_->lastCandidates();
+        if (candidates.size() > 1) {
+            reply["candidates"] = json::array();
+            for (const auto& candidate : candidates) {
+                reply["candidates"].push_back({{"command", candidate.command},
+                                               {"parses", candidate.parses},
+                                               {"missing_programs", candidate.missing_programs},
+                                               {"missing_paths", candidate.missing_paths}});
+            }
+        }
+    }
+    reply["source"] = timings_.source();
+    json phases = json::object();
+    for (int phase = 0; phase < Timings::PhaseCount; ++phase) {
+        double ms = timings_.get(static_cast<Timings::Phase>(phase));
+        if (ms > 0.0 && phase != Timings::Total) {
+            phases[Timings::name(static_cast<Timings::Phase>(phase))] = ms;
+        }
+    }
+    reply["timings"] = phases;
+    writeLine(fd, reply.dump());
+
+    Log::at(LogLevel::Normal) << "🛰️  " << cwd << ": \"" << natural_language << "\" -> "
+                              << (command.empty() ? "(none)" : command) << " ["
+                              << timings_.source() << ", " << timings_.get(Timings::Total)
+                              << " ms]" << std::endl;
+    return false;
+}
+
+bool GANPI::attachDaemon(const std::string& socket_path) {
+    int fd = connectTo(socket_path);
+    if (fd < 0) {
+        return false;
+    }
+    try {
+        // The daemon translates; confirmation and execution stay here
+        loadConfig();
+        createExecutor();
+    } catch (const std::exception& e) {
+        close(fd);
+        std::cerr << "❌ Exception during initialization: " << e.what() << std::endl;
+        return false;
+    }
+    daemon_fd_ = fd;
+    daemon_socket_ = socket_path;
+    Log::at(LogLevel::Verbose) << "🛰️  Using ganpid on " << socket_path << std::endl;
+    return true;
+}
+
+bool GANPI::translateWithDaemon(const std::string& natural_language, std::string& command,
+                                std::string& error) {
+    // One request per connection
+    int fd = daemon_fd_;
+    daemon_fd_ = -1;
+
+    char cwd[PATH_MAX];
+    std::string line;
+    bool answered = getcwd(cwd, sizeof(cwd)) != nullptr &&
+                    writeLine(fd, json{{"op", "translate"}, {"cwd", cwd}, {"request", natural_language},
+                                       {"refresh", !cache_lookups_}}.dump()) &&
+                    readLine(fd, line);
+    close(fd);
+    json reply = answered ? json::parse(line, nullptr, false) : json();
+    if (!answered || !reply.is_object()) {
+        return false;
+    }
+
+    command = stringField(reply, "command");
+    error = stringField(reply, "error");
+    auto cache_key = reply.find("cache_key");
+    if (cache_key != reply.end() && cache_key->is_number_unsigned()) {
+        cache_key_ = cache_key->get<uint64_t>();
+    }
+    if (reply.contains("candidates") && reply["candidates"].is_array()) {
+        for (const auto& entry : reply["candidates"]) {
+            if (!entry.is_object()) continue;
+            CommandCandidate candidate;
+            candidate.command = stringField(entry, "command");
+            auto parses = entry.find("parses");
+            candidate.parses = parses == entry.end() || !parses->is_boolean() || parses->get<bool>();
+            candidate.missing_programs = stringList(entry, "missing_programs");
+            candidate.missing_paths = stringList(entry, "missing_paths");
+            candidates_.push_back(std::move(candidate));
+        }
+    }
+    timings_.setSource(sourceLiteral(stringField(reply, "source")));
+    if (reply.contains("timings") && reply["timings"].is_object()) {
+        for (int phase = 0; phase < Timings::PhaseCount; ++phase) {
+            auto field = reply["timings"].find(Timings::name(static_cast<Timings::Phase>(phase)));
+            if (field != reply["timings"].end() && field->is_number()) {
+                timings_.add(static_cast<Timings::Phase>(phase), field->get<double>());
+            }
+        }
+    }
+    return true;
+}
+
+void GANPI::reportToDaemon(uint64_t key, const std::string& command, bool ran) {
+    int fd = connectTo(daemon_socket_);
+    if (fd < 0) {
+        return;
+    }
+    std::string line;
+    if (writeLine(fd, json{{"op", ran ? "accept" : "decline"}, {"key", key}, {"command", command}}.dump())) {
+        readLine(fd, line);
+    }
+    close(fd);
+}
+
+bool GANPI::stopDaemon(const std::string& socket_path) {
+    int fd = connectTo(socket_path);
+    if (fd < 0) {
+        std::cout << "❌ No ganpid running on " << socket_path << std::endl;
+        return false;
+    }
+    std::string line;
+    bool stopped = writeLine(fd, json{{"op", "stop"}}.dump()) && readLine(fd, line);
+    close(fd);
+    if (stopped) {
+        std::cout << "🛑 Stopped ganpid on " << socket_path << std::endl;
+    }
+    return stopped;
+}
+
+} // namespace ganpi
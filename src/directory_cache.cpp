@@ -0,0 +1,289 @@
+#include "ganpi.h"
+#include <algorithm>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+namespace ganpi {
+
+namespace {
+
+#ifdef __linux__
+const uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB |
+                            IN_MOVED_FROM | IN_MOVED_TO |
+                            IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+#endif
+
+bool readEntry(int dir_fd, const char* name, DirectoryEntry& entry) {
+    struct stat st;
+    if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        return false;
+    }
+    entry.name = name;
+    entry.mode = st.st_mode;
+    entry.is_directory = S_ISDIR(st.st_mode);
+    entry.is_regular = S_ISREG(st.st_mode);
+    entry.nlink = static_cast<unsigned long>(st.st_nlink);
+    entry.uid = st.st_uid;
+    entry.gid = st.st_gid;
+    entry.size = static_cast<long long>(st.st_size);
+    entry.blocks = static_cast<long long>(st.st_blocks);
+    entry.mtime = static_cast<long long>(st.st_mtime);
+    entry.link_target.clear();
+
+    if (S_ISLNK(st.st_mode)) {
+        char target[4096];
+        ssize_t len = readlinkat(dir_fd, name, target, sizeof(target) - 1);
+        if (len > 0) {
+            entry.link_target.assign(target, static_cast<size_t>(len));
+        }
+    }
+    return true;
+}
+
+bool isDotOrDotDot(const char* name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+bool entryNameLess(const DirectoryEntry& entry, const std::string& name) {
+    return entry.name < name;
+}
+
+// Read a whole directory (excluding . and ..), sorted by name
+void readDirectory(const std::string& path, DirectoryListing& listing) {
+    listing.entries.clear();
+    listing.exists = false;
+
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        return;
+    }
+    listing.exists = true;
+
+    int fd = dirfd(dir);
+    while (struct dirent* ent = readdir(dir)) {
+        if (isDotOrDotDot(ent->d_name)) {
+            continue;
+        }
+        listing.entries.emplace_back();
+        if (!readEntry(fd, ent->d_name, listing.entries.back())) {
+            listing.entries.pop_back();
+        }
+    }
+    closedir(dir);
+
+    std::sort(listing.entries.begin(), listing.entries.end(),
+              [](const DirectoryEntry& a, const DirectoryEntry& b) { return a.name < b.name; });
+}
+
+} // namespace
+
+DirectorySnapshotCache::DirectorySnapshotCache(size_t max_snapshots)
+    : max_snapshots_(std::max<size_t>(max_snapshots, 1)) {
+#ifdef __linux__
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+DirectorySnapshotCache::~DirectorySnapshotCache() {
+    if (inotify_fd_ >= 0) {
+        close(inotify_fd_);
+    }
+}
+
+std::string DirectorySnapshotCache::absolutePath(const std::string& path) const {
+    if (!path.empty() && path[0] == '/') {
+        return path;
+    }
+    // The working directory is read every time: a long-lived process (the
+    // REPL after cd, ganpid serving clients) does not stay in one place
+    char cwd[4096];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        return path.empty() ? "." : path;
+    }
+    std::string base = cwd;
+    if (path.empty() || path == ".") {
+        return base;
+    }
+    return base == "/" ? "/" + path : base + "/" + path;
+}
+
+const DirectoryListing& DirectorySnapshotCache::get(const std::string& path) {
+    drainEvents();
+
+    std::string key = absolutePath(path);
+    auto found = snapshots_.find(key);
+    if (found == snapshots_.end()) {
+        if (snapshots_.size() >= max_snapshots_) {
+            evictOldest();
+        }
+        recent_.push_front(key);
+        found = snapshots_.emplace(key, Snapshot()).first;
+        found->second.recent = recent_.begin();
+    } else {
+        recent_.splice(recent_.begin(), recent_, found->second.recent);
+    }
+    Snapshot& snapshot = found->second;
+    snapshot.listing.path = path;
+
+    if (snapshot.watch < 0 || snapshot.stale) {
+        // Watch before reading so changes made during the scan are not lost
+        watch(key, snapshot);
+        readDirectory(key, snapshot.listing);
+        snapshot.listing.version = ++next_version_;
+        snapshot.stale = false;
+        snapshot.dirty.clear();
+        ++full_scans_;
+        return snapshot.listing;
+    }
+
+    if (!snapshot.dirty.empty()) {
+        refreshDirty(key, snapshot);
+        snapshot.listing.version = ++next_version_;
+    }
+    return snapshot.listing;
+}
+
+void DirectorySnapshotCache::watch(const std::string& key, Snapshot& snapshot) {
+#ifdef __linux__
+    if (inotify_fd_ < 0 || snapshot.watch >= 0) {
+        return;
+    }
+    int wd = inotify_add_watch(inotify_fd_, key.c_str(), WATCH_MASK);
+    if (wd >= 0) {
+        snapshot.watch = wd;
+        watches_[wd] = key;
+    }
+#else
+    (void)key;
+    (void)snapshot;
+#endif
+}
+
+void DirectorySnapshotCache::evictOldest() {
+    auto it = snapshots_.find(recent_.back());
+    recent_.pop_back();
+    if (it == snapshots_.end()) {
+        return;
+    }
+#ifdef __linux__
+    // Its IN_IGNORED event finds no entry in watches_ and is skipped
+    if (it->second.watch >= 0) {
+        inotify_rm_watch(inotify_fd_, it->second.watch);
+        watches_.erase(it->second.watch);
+    }
+#endif
+    snapshots_.erase(it);
+}
+
+void DirectorySnapshotCache::refreshDirty(const std::string& key, Snapshot& snapshot) {
+    int fd = open(key.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        snapshot.stale = true;
+        snapshot.listing.exists = false;
+        snapshot.listing.entries.clear();
+        return;
+    }
+
+    auto& entries = snapshot.listing.entries;
+    DirectoryEntry entry;
+    for (const auto& name : snapshot.dirty) {
+        auto it = std::lower_bound(entries.begin(), entries.end(), name, entryNameLess);
+        bool present = (it != entries.end() && it->name == name);
+        if (readEntry(fd, name.c_str(), entry)) {
+            if (present) {
+                *it = entry;
+            } else {
+                entries.insert(it, entry);
+            }
+        } else if (present) {
+            entries.erase(it);
+        }
+        ++entries_restated_;
+    }
+    close(fd);
+    snapshot.dirty.clear();
+}
+
+void DirectorySnapshotCache::markDirty(const std::string& key, const std::string& name) {
+    auto it = snapshots_.find(key);
+    if (it != snapshots_.end()) {
+        it->second.dirty.insert(name);
+    }
+}
+
+void DirectorySnapshotCache::markParentDirty(const std::string& key) {
+    // A change inside a directory alters its own mtime/nlink as seen by its parent
+    size_t slash = key.find_last_of('/');
+    if (slash == std::string::npos || slash + 1 >= key.size()) {
+        return;
+    }
+    std::string parent = slash == 0 ? "/" : key.substr(0, slash);
+    markDirty(parent, key.substr(slash + 1));
+}
+
+void DirectorySnapshotCache::drainEvents() {
+#ifdef __linux__
+    if (inotify_fd_ < 0) {
+        return;
+    }
+
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    while (true) {
+        ssize_t len = read(inotify_fd_, buffer, sizeof(buffer));
+        if (len <= 0) {
+            break;
+        }
+        for (char* p = buffer; p < buffer + len; ) {
+            auto* event = reinterpret_cast<struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were dropped, so nothing cached can be trusted
+                for (auto& entry : snapshots_) {
+                    entry.second.stale = true;
+                }
+                continue;
+            }
+
+            auto watch_it = watches_.find(event->wd);
+            if (watch_it == watches_.end()) {
+                continue;
+            }
+            const std::string key = watch_it->second;
+            auto snap_it = snapshots_.find(key);
+
+            if (event->mask & IN_IGNORED) {
+                watches_.erase(watch_it);
+                if (snap_it != snapshots_.end()) {
+                    snap_it->second.watch = -1;
+                    snap_it->second.stale = true;
+                }
+                continue;
+            }
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                // The watch follows the inode, not the path, so drop it and rescan
+                inotify_rm_watch(inotify_fd_, event->wd);
+                watches_.erase(watch_it);
+                if (snap_it != snapshots_.end()) {
+                    snap_it->second.watch = -1;
+                    snap_it->second.stale = true;
+                }
+                continue;
+            }
+            if (event->len > 0 && snap_it != snapshots_.end()) {
+                snap_it->second.dirty.insert(event->name);
+                markParentDirty(key);
+            }
+        }
+    }
+#endif
+}
+
+} // namespace ganpi
@@ -2,18 +2,104 @@
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 namespace ganpi {
 
+namespace {
+
+// JSON string literal for s
+std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (unsigned char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    return out + "\"";
+}
+
+// What the dry run found wrong with a candidate, e.g. " (not found: foo; missing: ./x)"
+std::string describeIssues(const CommandCandidate& candidate) {
+    if (!candidate.parses) {
+        return " (does not parse)";
+    }
+    std::string issues;
+    auto list = [&issues](const char* label, const std::vector<std::string>& items) {
+        if (items.empty()) return;
+        issues += issues.empty() ? " (" : "; ";
+        issues += label;
+        for (size_t i = 0; i < items.size(); ++i) {
+            issues += (i == 0 ? " " : ", ") + items[i];
+        }
+    };
+    list("not found:", candidate.missing_programs);
+    list("missing:", candidate.missing_paths);
+    return issues.empty() ? "" : issues + ")";
+}
+
+} // namespace
+
 GANPI::GANPI() : config_(&Config::getInstance()) {
 }
 
+GANPI::~GANPI() {
+#ifndef _WIN32
+    if (daemon_fd_ >= 0) {
+        close(daemon_fd_);
+    }
+#endif
+}
+
+bool GANPI::loadConfig() {
+    // Command line flags win over LOG_LEVEL
+    bool config_loaded = config_->loadFromFile();
+    if (json_out_) {
+        Log::setLevel(LogLevel::Quiet);
+    } else {
+        Log::setLevel(log_level_set_ ? log_level_ : config_->getLogLevel());
+    }
+    return config_loaded;
+}
+
+void GANPI::createExecutor() {
+    executor_ = std::make_unique<CommandExecutor>();
+    if (json_out_) {
+        // Output goes into the JSON result instead of the terminal
+        executor_->setStreamOutput(false);
+    }
+    if (!config_->getSafetyRulesPath().empty() &&
+        !executor_->loadSafetyRules(config_->getSafetyRulesPath())) {
+        std::cout << "⚠️  Could not read safety rules from " << config_->getSafetyRulesPath() << std::endl;
+    }
+}
+
 bool GANPI::initialize() {
     try {
-        std::cout << "🔧 Initializing GANPI..." << std::endl;
+        bool config_loaded = loadConfig();
         
-        // Try to load configuration
-        bool config_loaded = config_->loadFromFile();
+        Log::at(LogLevel::Normal) << "🔧 Initializing GANPI..." << std::endl;
         
         if (!config_loaded || config_->getGeminiApiKey().empty()) {
             std::cout << "\n⚠️  No API key found. Let's set up your Gemini API key:" << std::endl;
@@ -37,17 +123,46 @@ bool GANPI::initialize() {
         
         // Initialize Gemini client
         gemini_client_ = std::make_unique<GeminiClient>(config_->getGeminiApiKey());
+        if (!config_->getApiBaseUrl().empty()) {
+            gemini_client_->setBaseUrl(config_->getApiBaseUrl());
+        }
+        gemini_client_->setStreaming(config_->getStreaming());
+        gemini_client_->setLocalIntentThreshold(config_->getLocalIntentThreshold());
+        gemini_client_->setTimings(&timings_);
+#ifndef _WIN32
+        gemini_client_->setContextTokenBudget(config_->getContextTokenBudget());
+        gemini_client_->setCandidateCount(config_->getCandidateCount());
+        GeminiClient::RequestPolicy policy;
+        policy.connect_timeout_ms = config_->getConnectTimeoutMs();
+        policy.deadline_ms = config_->getRequestDeadlineMs();
+        policy.max_retries = config_->getMaxRetries();
+        policy.retry_base_ms = config_->getRetryBaseMs();
+        policy.hedge_after_ms = config_->getHedgeAfterMs();
+        gemini_client_->setRequestPolicy(policy);
+        gemini_client_->setCacheLookups(cache_lookups_);
+        if (!config_->getResponseCachePath().empty()) {
+            auto cache = std::make_unique<ResponseCache>(config_->getResponseCachePath(),
+                                                         config_->getResponseCacheTtl(),
+                                                         config_->getResponseCacheEntries());
+            if (cache->isOpen()) {
+                gemini_client_->setResponseCache(std::move(cache));
+            }
+        }
+#endif
         
-        // Validate API key
-        if (!gemini_client_->validateApiKey()) {
+        // Validate API key lazily: a cached result skips the round trip, and
+        // otherwise the first real request doubles as the validation
+        int cached_validation = config_->getCachedKeyValidation(config_->getGeminiApiKey());
+        if (cached_validation == 0) {
             std::cout << "❌ Invalid API key. Please check your Gemini API key." << std::endl;
             return false;
         }
+        key_validated_ = (cached_validation == 1);
         
         // Initialize command executor
-        executor_ = std::make_unique<CommandExecutor>();
+        createExecutor();
         
-        std::cout << "✅ GANPI initialized successfully!" << std::endl;
+        Log::at(LogLevel::Normal) << "✅ GANPI initialized successfully!" << std::endl;
         return true;
     } catch (const std::exception& e) {
         std::cerr << "❌ Exception during initialization: " << e.what() << std::endl;
@@ -59,36 +174,110 @@ bool GANPI::initialize() {
 }
 
 void GANPI::processCommand(const std::string& natural_language) {
-    if (!gemini_client_ || !executor_) {
+    if ((!gemini_client_ && daemon_fd_ < 0) || !executor_) {
         std::cout << "❌ GANPI not properly initialized." << std::endl;
         return;
     }
     
-    std::cout << "\n🧠 Processing: \"" << natural_language << "\"" << std::endl;
+    timings_.reset();
+    request_started_ = std::chrono::steady_clock::now();
+    runRequest(natural_language);
+    timings_.add(Timings::Total, std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - request_started_).count());
+    reportTimings(natural_language);
+}
+
+void GANPI::runRequest(const std::string& natural_language) {
+    Log::at(LogLevel::Normal) << "\n🧠 Processing: \"" << natural_language << "\"" << std::endl;
     
-    // Get command from Gemini
-    std::string shell_command = gemini_client_->interpretCommand(natural_language);
+    // Get command from Gemini, through ganpid when attached
+    std::string shell_command;
+    bool translated = false;
+    candidates_.clear();
+    cache_key_ = 0;
+#ifndef _WIN32
+    if (daemon_fd_ >= 0) {
+        std::string error;
+        translated = translateWithDaemon(natural_language, shell_command, error);
+        if (!error.empty()) {
+            if (json_out_) {
+                printJsonResult(natural_language, shell_command, nullptr, error);
+            }
+            std::cout << "❌ " << error << std::endl;
+            return;
+        }
+        if (!translated) {
+            Log::at(LogLevel::Normal) << "⚠️  ganpid did not answer; translating locally" << std::endl;
+            if (!initialize()) {
+                return;
+            }
+        }
+    }
+#endif
+    if (!translated) {
+        shell_command = gemini_client_->interpretCommand(natural_language);
+        if (!checkApiKeyStatus()) {
+            return;
+        }
+#ifndef _WIN32
+        candidates_ = gemini_client_->lastCandidates();
+        cache_key_ = gemini_client_->lastCacheKey();
+        if (shell_command.empty() && !gemini_client_->lastError().empty()) {
+            std::string error = "Gemini API request failed: " + gemini_client_->lastError();
+            if (json_out_) {
+                printJsonResult(natural_language, shell_command, nullptr, error);
+            }
+            std::cout << "❌ " << error << std::endl;
+            return;
+        }
+#endif
+    }
     
     if (shell_command.empty()) {
+        if (json_out_) {
+            printJsonResult(natural_language, shell_command, nullptr);
+        }
         std::cout << "❌ Could not interpret the command. Please try rephrasing." << std::endl;
         return;
     }
     
     // Show what command will be executed
     printCommandPreview(shell_command);
+    if (!candidates_.empty() && !candidates_[0].viable()) {
+        std::cout << "⚠️  Dry run:" << describeIssues(candidates_[0]) << std::endl;
+    }
+    if (candidates_.size() > 1) {
+        Log::at(LogLevel::Normal) << "   💡 " << candidates_.size() - 1
+                                  << " alternative(s) ready if you decline" << std::endl;
+    }
     
-    // Execute with confirmation
+    // Execute with confirmation. The time around the command itself is the
+    // confirmation prompt and the safety checks.
+    auto confirm_start = std::chrono::steady_clock::now();
     auto result = executor_->executeWithConfirmation(shell_command);
+    while (result.exit_code == -1 && chooseAlternative(shell_command)) {
+        result = executor_->executeWithConfirmation(shell_command);
+    }
+    reportOutcome(shell_command, result.exit_code != -1, translated);
+    double confirm_and_run_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - confirm_start).count();
+    timings_.add(Timings::Confirm, std::max(confirm_and_run_ms - result.wall_time_ms, 0.0));
+    timings_.add(Timings::Execute, result.wall_time_ms);
+    
+    if (json_out_) {
+        printJsonResult(natural_language, shell_command, &result);
+        return;
+    }
     
     if (result.success) {
-        std::cout << "\n✅ Command executed successfully!" << std::endl;
-        if (!result.output.empty()) {
+        Log::at(LogLevel::Normal) << "\n✅ Command executed successfully!" << std::endl;
+        if (!result.output.empty() && !result.output_streamed) {
             std::cout << "\n📄 Output:" << std::endl;
             std::cout << result.output << std::endl;
         }
     } else {
         std::cout << "\n❌ Command failed: " << result.error << std::endl;
-        if (!result.output.empty()) {
+        if (!result.output.empty() && !result.output_streamed) {
             std::cout << "\n📄 Output:" << std::endl;
             std::cout << result.output << std::endl;
         }
@@ -101,12 +290,33 @@ void GANPI::runInteractive() {
         return;
     }
     
-    printWelcomeMessage();
+    if (Log::enabled(LogLevel::Normal)) {
+        printWelcomeMessage();
+    }
+    
+    // Build the context while the user types, and optionally start the
+    // translation itself once they pause
+    LineEditor editor;
+#ifndef _WIN32
+    // Speculations finish on the engine thread while the terminal is raw
+    gemini_client_->setErrorHandler([&editor](const std::string& message) { editor.showMessage(message); });
+    editor.onFirstKey([this](const std::string&) { gemini_client_->prefetchContext(); });
+    if (config_->getSpeculateAfterMs() > 0) {
+        editor.onPause(std::chrono::milliseconds(config_->getSpeculateAfterMs()),
+                       [this](const std::string& partial) {
+                           if (partial != "quit" && partial != "exit" && partial != "q") {
+                               gemini_client_->speculate(partial);
+                           }
+                       });
+    }
+#endif
     
     std::string input;
     while (true) {
-        std::cout << "\n💬 What would you like me to do? (or 'quit' to exit): ";
-        std::getline(std::cin, input);
+        if (!editor.readLine("\n💬 What would you like me to do? (or 'quit' to exit): ", input)) {
+            std::cout << "👋 Goodbye!" << std::endl;
+            break;
+        }
         
         if (input == "quit" || input == "exit" || input == "q") {
             std::cout << "👋 Goodbye!" << std::endl;
@@ -119,8 +329,215 @@ void GANPI::runInteractive() {
         
         processCommand(input);
     }
+#ifndef _WIN32
+    gemini_client_->setErrorHandler(nullptr);
+#endif
 }
 
+void GANPI::runBatch(const std::string& filename, bool auto_confirm) {
+    if (!gemini_client_ || !executor_) {
+        std::cout << "❌ GANPI not properly initialized." << std::endl;
+        return;
+    }
+    
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cout << "❌ Could not open batch file: " << filename << std::endl;
+        return;
+    }
+    
+    // One request per line; blank lines and # comments are ignored
+    std::vector<std::string> requests;
+    std::string line;
+    while (std::getline(file, line)) {
+        line.erase(0, line.find_first_not_of(" \t\r"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (!line.empty() && line[0] != '#') {
+            requests.push_back(line);
+        }
+    }
+    
+    if (requests.empty()) {
+        std::cout << "❌ No requests found in " << filename << std::endl;
+        return;
+    }
+    
+    Log::at(LogLevel::Normal) << "\n📋 Batch: " << requests.size() << " request(s) from " << filename << std::endl;
+    
+    std::vector<std::string> commands =
+        gemini_client_->interpretBatch(requests, config_->getBatchConcurrency());
+    
+    if (!checkApiKeyStatus()) {
+        return;
+    }
+    
+    // Execute strictly in submission order
+    size_t succeeded = 0, failed = 0, skipped = 0;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        std::cout << "\n━━━ [" << (i + 1) << "/" << requests.size() << "] " << requests[i] << std::endl;
+        
+        if (commands[i].empty()) {
+            if (json_out_) {
+                printJsonResult(requests[i], commands[i], nullptr);
+            }
+            std::cout << "❌ Could not interpret the command." << std::endl;
+            ++failed;
+            continue;
+        }
+        
+        // Translations overlapped each other, so only execution is timed per request
+        timings_.reset();
+        timings_.setSource("batch");
+        request_started_ = std::chrono::steady_clock::now();
+        
+        printCommandPreview(commands[i]);
+        auto result = auto_confirm ? executor_->executeUnattended(commands[i])
+                                   : executor_->executeWithConfirmation(commands[i]);
+        double confirm_and_run_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - request_started_).count();
+        timings_.add(Timings::Confirm, std::max(confirm_and_run_ms - result.wall_time_ms, 0.0));
+        timings_.add(Timings::Execute, result.wall_time_ms);
+        
+        if (result.success) {
+            ++succeeded;
+        } else if (result.exit_code == -1) {
+            ++skipped;
+        } else {
+            ++failed;
+        }
+        
+        if (json_out_) {
+            printJsonResult(requests[i], commands[i], &result);
+        } else {
+            if (result.success) {
+                std::cout << "✅ Exit code 0" << std::endl;
+            } else if (result.exit_code == -1) {
+                std::cout << "⏭️  " << result.error << std::endl;
+            } else {
+                std::cout << "❌ " << result.error << std::endl;
+            }
+            if (!result.output.empty() && !result.output_streamed) {
+                std::cout << result.output;
+                if (result.output.back() != '\n') std::cout << std::endl;
+            }
+        }
+        
+        timings_.add(Timings::Total, confirm_and_run_ms);
+        reportTimings(requests[i]);
+    }
+    
+    // Batch summaries go to the terminal even in JSON mode (stdout then holds only the results)
+    std::cout << "\n📊 Batch complete: " << succeeded << " succeeded, " << failed
+              << " failed, " << skipped << " skipped" << std::endl;
+}
+
+void GANPI::setLogLevel(LogLevel level) {
+    log_level_ = level;
+    log_level_set_ = true;
+}
+
+void GANPI::setJsonOutput(std::ostream* out) {
+    json_out_ = out;
+}
+
+void GANPI::setShowTimings(bool enabled) {
+    show_timings_ = enabled;
+}
+
+void GANPI::setCacheLookups(bool enabled) {
+    cache_lookups_ = enabled;
+}
+
+void GANPI::reportOutcome(const std::string& command, bool ran, bool via_daemon) {
+#ifndef _WIN32
+    if (cache_key_ == 0) {
+        return;
+    }
+    if (via_daemon) {
+        reportToDaemon(cache_key_, command, ran);
+    } else if (ran) {
+        gemini_client_->acceptCommand(cache_key_, command);
+    } else {
+        gemini_client_->declineCommand(cache_key_);
+    }
+#else
+    (void)command;
+    (void)ran;
+    (void)via_daemon;
+#endif
+}
+
+void GANPI::reportTimings(const std::string& natural_language) {
+    if (show_timings_) {
+        std::cout << "\n" << timings_.report();
+    }
+    
+    // One JSON line per request, for aggregating across runs
+    std::string path = config_->getTimingsLogPath();
+    if (!path.empty()) {
+        std::ofstream log(path, std::ios::app);
+        if (log.is_open()) {
+            log << "{\"time\":" << static_cast<long long>(time(nullptr))
+                << ",\"request\":" << jsonString(natural_language)
+                << ",\"timings\":" << timings_.json() << "}\n";
+        }
+    }
+}
+
+void GANPI::printJsonResult(const std::string& request, const std::string& command,
+                            const CommandExecutor::ExecutionResult* result, const std::string& error) {
+    // One object per line; exit_code -1 means the command never ran
+    std::ostream& out = *json_out_;
+    out << "{\"request\":" << jsonString(request) << ",\"command\":" << jsonString(command);
+    if (!result) {
+        out << ",\"executed\":false,\"success\":false,\"error\":"
+            << jsonString(error) << "}" << std::endl;
+        return;
+    }
+    out << ",\"executed\":" << (result->exit_code != -1 ? "true" : "false")
+        << ",\"success\":" << (result->success ? "true" : "false")
+        << ",\"exit_code\":" << result->exit_code
+        << ",\"signal\":" << result->term_signal
+        << ",\"stdout\":" << jsonString(result->stdout_output)
+        << ",\"stderr\":" << jsonString(result->stderr_output)
+        << ",\"error\":" << jsonString(result->error)
+        << ",\"wall_time_ms\":" << result->wall_time_ms
+        << ",\"user_time_ms\":" << result->user_time_ms
+        << ",\"sys_time_ms\":" << result->sys_time_ms
+        << ",\"max_rss_kb\":" << result->max_rss_kb;
+    if (show_timings_) {
+        // Written before processCommand returns, so the total is the time so far
+        Timings snapshot = timings_;
+        snapshot.add(Timings::Total, std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - request_started_).count());
+        out << ",\"timings\":" << snapshot.json();
+    }
+    out << "}" << std::endl;
+}
+
+#ifdef _WIN32
+
+// ganpid needs Unix domain sockets; on Windows every invocation runs locally
+int GANPI::runDaemon(const std::string&) {
+    std::cout << "❌ Daemon mode is not available on Windows." << std::endl;
+    return 1;
+}
+
+bool GANPI::attachDaemon(const std::string&) {
+    return false;
+}
+
+bool GANPI::stopDaemon(const std::string&) {
+    std::cout << "❌ Daemon mode is not available on Windows." << std::endl;
+    return false;
+}
+
+std::string GANPI::defaultSocketPath() {
+    return "";
+}
+
+#endif
+
 void GANPI::showHelp() {
     std::cout << R"(
 🧠 GANPI - Gemini-Assisted Natural Processing Interface
@@ -128,8 +545,20 @@ void GANPI::showHelp() {
 USAGE:
     ganpi "natural language command"    # Execute a single command
     ganpi --interactive                 # Start interactive mode
+    ganpi --batch <file> [--yes]        # Translate and run one request per line
+    ganpi --daemon                      # Run ganpid: later invocations forward to it
+    ganpi --stop-daemon                 # Stop a running ganpid
     ganpi --help                        # Show this help
 
+OPTIONS (before the command):
+    --quiet, -q        Only prompts, results and errors
+    --verbose, -v      Also show the context, request and response dumps
+    --trace            Also show libcurl's wire log
+    --json             Print one JSON object per request (command and result)
+    --timings          Show where the time went after each request
+    --no-daemon        Translate in this process even if ganpid is running
+    --no-cache         Ask the API even if the response cache has an answer
+
 EXAMPLES:
     ganpi "Find all PDF files in Downloads and zip them"
     ganpi "Move all .txt files from Downloads to Documents/notes"
@@ -154,6 +583,22 @@ For more examples and documentation, visit: https://github.com/your-repo/ganpi
 )" << std::endl;
 }
 
+bool GANPI::checkApiKeyStatus() {
+    if (gemini_client_->apiKeyRejected()) {
+        std::cout << "❌ Invalid API key. Please check your Gemini API key." << std::endl;
+        config_->cacheKeyValidation(config_->getGeminiApiKey(), false);
+        key_validated_ = false;
+        return false;
+    }
+    
+    long status = gemini_client_->lastHttpStatus();
+    if (!key_validated_ && status >= 200 && status < 300) {
+        config_->cacheKeyValidation(config_->getGeminiApiKey(), true);
+        key_validated_ = true;
+    }
+    return true;
+}
+
 void GANPI::printWelcomeMessage() {
     std::cout << R"(
     ╔══════════════════════════════════════════════════════════════╗
@@ -169,9 +614,36 @@ void GANPI::printWelcomeMessage() {
 )" << std::endl;
 }
 
+bool GANPI::chooseAlternative(std::string& command) {
+    // The declined command is not offered again
+    candidates_.erase(std::remove_if(candidates_.begin(), candidates_.end(),
+                                     [&command](const CommandCandidate& c) { return c.command == command; }),
+                      candidates_.end());
+    if (candidates_.empty()) {
+        return false;
+    }
+    
+    std::cout << "\n🔀 Other candidates from the same response:" << std::endl;
+    for (size_t i = 0; i < candidates_.size(); ++i) {
+        std::cout << "   " << (i + 1) << ") " << candidates_[i].command << describeIssues(candidates_[i]) << std::endl;
+    }
+    std::cout << "\n   Pick one (1-" << candidates_.size() << "), or Enter to stop: ";
+    
+    std::string answer;
+    if (!std::getline(std::cin, answer)) {
+        return false;
+    }
+    long pick = std::atol(answer.c_str());
+    if (pick < 1 || pick > static_cast<long>(candidates_.size())) {
+        return false;
+    }
+    command = candidates_[pick - 1].command;
+    return true;
+}
+
 void GANPI::printCommandPreview(const std::string& command) {
-    std::cout << "\n🔧 GANPI suggests this command:" << std::endl;
-    std::cout << "   $ " << command << std::endl;
+    Log::at(LogLevel::Normal) << "\n🔧 GANPI suggests this command:" << std::endl;
+    Log::at(LogLevel::Normal) << "   $ " << command << std::endl;
 }
 
 } // namespace ganpi
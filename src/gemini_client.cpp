@@ -1,10 +1,10 @@
 #include "ganpi.h"
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
 #include <sstream>
-#include <cstdio>
-#include <algorithm>
-#include <regex>
-#include <set>
+#include <mutex>
+#include <random>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -17,82 +17,80 @@
 
 namespace ganpi {
 
-// Helper function to execute a command and capture output
-std::string executeAndCapture(const std::string& cmd) {
-    std::string result;
-    // On Windows with Git Bash, need to explicitly use bash
-    std::string full_cmd = "bash -c \"" + cmd + "\"";
-    FILE* pipe = _popen(full_cmd.c_str(), "r");
-    if (!pipe) return "";
-    
-    char buffer[256];
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        result += buffer;
-    }
-    _pclose(pipe);
-    return result;
+// A connection used this recently is assumed to be open still and is not warmed
+static const std::chrono::seconds WARMUP_IDLE(20);
+
+// Upper bound on a warm-up, so an unreachable endpoint cannot hold the handle
+static const long WARMUP_TIMEOUT_MS = 5000;
+
+// Ceiling for the backoff between retries
+static const long RETRY_CAP_MS = 8000;
+
+// Doublings of the backoff base, enough to reach the cap from 1 ms
+static const int RETRY_MAX_DOUBLINGS = 13;
+
+// Attempts per call at most, whatever max_retries says
+static const int RETRY_MAX_ATTEMPTS = 100;
+
+// Automatic hedging needs this many recent calls, and keeps at most the last HEDGE_SAMPLES
+static const size_t HEDGE_MIN_SAMPLES = 8;
+static const size_t HEDGE_SAMPLES = 64;
+
+// Statuses that say "try again later" rather than "this request is wrong"
+static bool retryableStatus(long status) {
+    return status == 408 || status == 429 || status == 500 || status == 502 ||
+           status == 503 || status == 504;
 }
 
-// Get file system context for directories mentioned in the query
-std::string getFileSystemContext(const std::string& query) {
-    std::string context = "\n=== FILE SYSTEM CONTEXT ===\n";
-    
-    // Get current directory
-    std::string pwd = executeAndCapture("pwd");
-    if (!pwd.empty()) {
-        pwd.erase(pwd.find_last_not_of("\n\r") + 1);
-        context += "Current directory: " + pwd + "\n";
-    }
-    
-    // ALWAYS show current directory structure first
-    context += "\n--- Current Directory Structure ---\n";
-    std::string current_structure = executeAndCapture("ls -lAh 2>/dev/null");
-    if (!current_structure.empty()) {
-        context += current_structure;
+// Transport failures a new attempt (likely on a new connection) may not hit
+static bool retryableTransfer(CURLcode result) {
+    switch (result) {
+        case CURLE_COULDNT_RESOLVE_HOST:
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_SSL_CONNECT_ERROR:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_HTTP2:
+        case CURLE_HTTP2_STREAM:
+            return true;
+        default:
+            return false;
     }
-    
-    // Show directory tree (limited depth for performance)
-    context += "\n--- Directory Tree (2 levels) ---\n";
-    std::string tree = executeAndCapture("find . -maxdepth 2 -type d 2>/dev/null | head -30");
-    if (!tree.empty()) {
-        context += tree;
-    }
-    
-    // List all files in current directory (non-hidden)
-    context += "\n--- All Files in Current Directory ---\n";
-    std::string files_list = executeAndCapture("find . -maxdepth 1 -type f 2>/dev/null");
-    if (!files_list.empty()) {
-        context += files_list;
+}
+
+// Milliseconds with one decimal, for timing lines
+static std::string formatMs(double ms) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.1f ms", ms);
+    return buffer;
+}
+
+// Split libcurl's cumulative timers for the last transfer into phases
+static void recordTransferTimes(CURL* curl, Timings* timings) {
+    if (!timings) {
+        return;
     }
+    curl_off_t lookup = 0, connect = 0, app_connect = 0, pretransfer = 0, first_byte = 0, total = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &lookup);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &app_connect);
+    curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
     
-    // Extract potential directory names from query and show their contents
-    std::regex dir_pattern(R"(\b(test|dir1|dir2|downloads?|documents?|backup|temp|home|desktop)\b)");
-    std::smatch match;
-    std::string lower_query = query;
-    std::transform(lower_query.begin(), lower_query.end(), lower_query.begin(), ::tolower);
-    
-    std::set<std::string> found_dirs;
-    std::string::const_iterator searchStart(lower_query.cbegin());
-    while (std::regex_search(searchStart, lower_query.cend(), match, dir_pattern)) {
-        found_dirs.insert(match[0].str());
-        searchStart = match.suffix().first;
+    // Values are microseconds from the start; app_connect stays 0 without TLS
+    timings->add(Timings::Dns, lookup / 1000.0);
+    timings->add(Timings::Connect, std::max<curl_off_t>(connect - lookup, 0) / 1000.0);
+    if (app_connect > 0) {
+        timings->add(Timings::Tls, std::max<curl_off_t>(app_connect - connect, 0) / 1000.0);
     }
-    
-    // List files in specifically mentioned directories
-    if (!found_dirs.empty()) {
-        context += "\n--- Mentioned Directories ---\n";
-        for (const auto& dir : found_dirs) {
-            std::string ls_output = executeAndCapture("ls -lAh " + dir + " 2>/dev/null | head -30");
-            if (!ls_output.empty()) {
-                context += "\nContents of " + dir + "/:\n" + ls_output;
-            } else {
-                context += "\n" + dir + "/ does not exist or is empty\n";
-            }
-        }
+    if (first_byte > 0) {
+        timings->add(Timings::Ttfb, std::max<curl_off_t>(first_byte - pretransfer, 0) / 1000.0);
+        timings->add(Timings::Transfer, std::max<curl_off_t>(total - first_byte, 0) / 1000.0);
     }
-    
-    context += "\n===========================\n";
-    return context;
 }
 
 // Callback function for libcurl to write response data
@@ -107,18 +105,68 @@ static size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::stri
     }
 }
 
-GeminiClient::GeminiClient(const std::string& api_key) 
-    : api_key_(api_key), model_("gemini-pro") {
+// Find a complete ```bash fenced block in generated text
+static bool findFencedCommand(const std::string& generated_text, std::string& command) {
+    size_t bash_start = generated_text.find("```bash");
+    if (bash_start == std::string::npos) {
+        return false;
+    }
+    bash_start += 7; // Length of "```bash"
+    size_t bash_end = generated_text.find("```", bash_start);
+    if (bash_end == std::string::npos) {
+        return false;
+    }
+    command = generated_text.substr(bash_start, bash_end - bash_start);
+    // Remove leading/trailing whitespace
+    command.erase(0, command.find_first_not_of(" \t\n\r"));
+    command.erase(command.find_last_not_of(" \t\n\r") + 1);
+    return true;
 }
 
-std::string GeminiClient::interpretCommand(const std::string& natural_language) {
-    // Gather file system context
-    std::string fs_context = getFileSystemContext(natural_language);
-    std::cout << "\n📂 Analyzing file system context..." << std::endl;
-    std::cout << fs_context << std::endl;
+// Extract the shell command from Gemini's generated text
+static std::string extractCommand(const std::string& generated_text) {
+    // Look for commands between ```bash and ``` or just the command itself
+    std::string command;
+    if (findFencedCommand(generated_text, command)) {
+        return command;
+    }
     
-    std::string prompt = buildPrompt(natural_language, fs_context);
+    // If no code blocks, try to extract first line that looks like a command
+    std::istringstream iss(generated_text);
+    std::string line;
+    while (std::getline(iss, line)) {
+        line.erase(0, line.find_first_not_of(" \t"));
+        if (!line.empty() && (line[0] == '$' || line.find_first_of("abcdefghijklmnopqrstuvwxyz") == 0)) {
+            if (line[0] == '$') {
+                line = line.substr(1);
+                line.erase(0, line.find_first_not_of(" \t"));
+            }
+            return line;
+        }
+    }
     
+    return generated_text;
+}
+
+// Text of one candidate (the first by default) in a generateContent response (or stream chunk)
+static bool appendCandidateText(const nlohmann::json& response_json, std::string& text, size_t index = 0) {
+    if (response_json.contains("candidates") && 
+        response_json["candidates"].size() > index &&
+        response_json["candidates"][index].contains("content") &&
+        response_json["candidates"][index]["content"].contains("parts") &&
+        response_json["candidates"][index]["content"]["parts"].size() > 0) {
+        for (const auto& part : response_json["candidates"][index]["content"]["parts"]) {
+            if (part.contains("text")) {
+                text += part["text"].get<std::string>();
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+// generateContent request body for a prompt
+static nlohmann::json buildRequestJson(const std::string& prompt, int candidate_count = 1) {
     nlohmann::json request_json;
     request_json["contents"] = nlohmann::json::array();
     request_json["contents"][0] = nlohmann::json::object();
@@ -129,73 +177,818 @@ std::string GeminiClient::interpretCommand(const std::string& natural_language)
     request_json["generationConfig"] = nlohmann::json::object();
     request_json["generationConfig"]["temperature"] = 0.1;
     request_json["generationConfig"]["maxOutputTokens"] = 1000;
+    if (candidate_count > 1) {
+        // Near-greedy sampling would return the same command several times
+        request_json["generationConfig"]["temperature"] = 0.7;
+        request_json["generationConfig"]["candidateCount"] = candidate_count;
+    }
+    return request_json;
+}
+
+// Shell command from a complete generateContent response body. Parse errors
+// go to error when given, otherwise to std::cerr.
+static std::string commandFromResponse(const std::string& response, Timings* timings = nullptr,
+                                       std::string* error = nullptr) {
+    try {
+        std::string generated_text;
+        bool has_text;
+        {
+            Timings::Scope timer(timings, Timings::Parse);
+            nlohmann::json response_json = nlohmann::json::parse(response);
+            has_text = appendCandidateText(response_json, generated_text);
+        }
+        if (has_text) {
+            // Extract shell command from the response
+            Timings::Scope timer(timings, Timings::Extract);
+            return extractCommand(generated_text);
+        }
+    } catch (const std::exception& e) {
+        std::string message = std::string("Error parsing Gemini response: ") + e.what();
+        if (error) {
+            *error = message;
+        } else {
+            std::cerr << message << std::endl;
+        }
+    }
+    
+    return "";
+}
+
+// Shell command of every candidate in a complete generateContent response body
+static std::vector<std::string> commandsFromResponse(const std::string& response, Timings* timings) {
+    std::vector<std::string> commands;
+    try {
+        std::vector<std::string> texts;
+        {
+            Timings::Scope timer(timings, Timings::Parse);
+            nlohmann::json response_json = nlohmann::json::parse(response);
+            std::string text;
+            for (size_t i = 0; appendCandidateText(response_json, text, i); ++i) {
+                texts.push_back(std::move(text));
+                text.clear();
+            }
+        }
+        Timings::Scope timer(timings, Timings::Extract);
+        for (const auto& text : texts) {
+            commands.push_back(extractCommand(text));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error parsing Gemini response: " << e.what() << std::endl;
+    }
+    return commands;
+}
+
+// Incremental state for a streamGenerateContent (SSE) transfer
+struct StreamState {
+    std::string pending;     // bytes not yet split into lines
+    std::string event_data;  // data: lines of the event being assembled
+    std::string raw;         // everything received, for diagnostics
+    std::string text;        // generated text so far
+    std::string command;     // set once the closing fence has arrived
+    bool complete = false;
+    
+    void dispatchEvent() {
+        if (event_data.empty()) {
+            return;
+        }
+        try {
+            appendCandidateText(nlohmann::json::parse(event_data), text);
+        } catch (const std::exception& e) {
+            std::cerr << "Error parsing Gemini stream chunk: " << e.what() << std::endl;
+        }
+        event_data.clear();
+    }
+    
+    void feed(const char* data, size_t length) {
+        raw.append(data, length);
+        pending.append(data, length);
+        
+        size_t start = 0;
+        size_t newline;
+        while ((newline = pending.find('\n', start)) != std::string::npos) {
+            size_t end = newline;
+            if (end > start && pending[end - 1] == '\r') {
+                --end;
+            }
+            if (end == start) {
+                dispatchEvent();
+            } else if (pending.compare(start, 5, "data:") == 0) {
+                size_t value = start + 5;
+                if (value < end && pending[value] == ' ') {
+                    ++value;
+                }
+                if (!event_data.empty()) {
+                    event_data += '\n';
+                }
+                event_data.append(pending, value, end - value);
+            }
+            start = newline + 1;
+        }
+        pending.erase(0, start);
+    }
+};
+
+// Callback for streamed responses; stops the transfer once the command is known
+static size_t StreamCallback(void* contents, size_t size, size_t nmemb, StreamState* state) {
+    size_t length = size * nmemb;
+    try {
+        state->feed(static_cast<const char*>(contents), length);
+    } catch (std::bad_alloc& e) {
+        return 0;
+    }
+    if (findFencedCommand(state->text, state->command)) {
+        state->complete = true;
+        return 0; // Abort: the rest of the response is not needed
+    }
+    return length;
+}
+
+// Progress callback of the warm-up; aborts it once cancelled
+static int WarmupProgress(void* cancelled, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    return static_cast<std::atomic<bool>*>(cancelled)->load() ? 1 : 0;
+}
+
+// Persistent libcurl state. One easy handle is kept for the lifetime of the
+// client so its connection cache survives between requests, and a share
+// object holds the DNS and TLS session caches for any further handles
+// (concurrent or hedged requests) created later. Connections are not
+// shared: a shared pool caps how many a multi handle can open at once.
+// Synchronous transfers run on a private multi handle instead, so the
+// persistent handle and the hedge handle draw on one connection cache.
+struct GeminiClient::HttpSession {
+    CURL* curl = nullptr;
+    CURL* hedge = nullptr;
+    CURLM* multi = nullptr;
+    CURLSH* share = nullptr;
+    struct curl_slist* headers = nullptr;
+    std::mutex share_locks[CURL_LOCK_DATA_LAST];
+    // Limits for handles created from now on (0 = none)
+    long connect_timeout_ms = 0;
+    long timeout_ms = 0;
+    std::string ca_bundle;          // PEM file trusted instead of the system store
     
-    std::string url = "https://generativelanguage.googleapis.com/v1beta/models/" + 
-                      model_ + ":generateContent?key=" + api_key_;
+    HttpSession() {
+        static std::once_flag global_init;
+        std::call_once(global_init, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+        
+        share = curl_share_init();
+        if (share) {
+            curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockShare);
+            curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+            curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+            curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        }
+        
+        headers = curl_slist_append(headers, "Content-Type: application/json");
+        // Send bodies straight away instead of waiting on 100-continue
+        headers = curl_slist_append(headers, "Expect:");
+        curl = createHandle();
+        multi = curl_multi_init();
+        if (!multi && curl) {
+            curl_easy_cleanup(curl);
+            curl = nullptr;
+        }
+    }
     
-    // Print API request data
-    std::cout << "\n🌐 Calling Gemini API..." << std::endl;
-    std::cout << "📤 Request Data:\n" << request_json.dump(2) << std::endl;
-    std::cout << "\n⏳ Waiting for response...\n" << std::endl;
+    ~HttpSession() {
+        if (hedge) curl_easy_cleanup(hedge);
+        if (curl) curl_easy_cleanup(curl);
+        if (multi) curl_multi_cleanup(multi);
+        if (share) curl_share_cleanup(share);
+        curl_slist_free_all(headers);
+    }
     
-    std::string response = makeHttpRequest(url, request_json.dump());
+    // Handle for hedged requests, created on first use. It always opens a
+    // connection of its own, so whatever stalled the first request (a slow
+    // or dead connection) cannot stall both.
+    CURL* hedgeHandle() {
+        if (!hedge) {
+            hedge = createHandle();
+            if (hedge) curl_easy_setopt(hedge, CURLOPT_FRESH_CONNECT, 1L);
+        }
+        return hedge;
+    }
     
-    // Print API response
-    std::cout << "📥 Response received from Gemini API" << std::endl;
-    std::cout << "📄 Raw Response:\n" << response << std::endl;
-    std::cout << "\n🔍 Parsing response...\n" << std::endl;
+    struct Race {
+        bool accepted = false;
+        int slot = 0;               // the accepted transfer, or else the last to finish
+        CURLcode result = CURLE_OK;
+        bool hedged = false;        // handles[1] was sent
+    };
     
-    try {
-        nlohmann::json response_json = nlohmann::json::parse(response);
+    // Run handles[0] now and handles[1] (if not null) once hedge_after_ms has
+    // passed without an accepted result. A transfer still running when the
+    // other is accepted is abandoned.
+    Race perform(CURL* const handles[2], long hedge_after_ms,
+                 const std::function<bool(int, CURLcode)>& accept) {
+        bool running[2] = {true, false};
+        bool hedge_pending = handles[1] != nullptr;
+        auto hedge_at = std::chrono::steady_clock::now() + std::chrono::milliseconds(hedge_after_ms);
+        Race race;
+        bool& accepted = race.accepted;
+        curl_multi_add_handle(multi, handles[0]);
         
-        if (response_json.contains("candidates") && 
-            response_json["candidates"].size() > 0 &&
-            response_json["candidates"][0].contains("content") &&
-            response_json["candidates"][0]["content"].contains("parts") &&
-            response_json["candidates"][0]["content"]["parts"].size() > 0) {
-            
-            std::string generated_text = response_json["candidates"][0]["content"]["parts"][0]["text"];
-            
-            // Extract shell command from the response
-            // Look for commands between ```bash and ``` or just the command itself
-            size_t bash_start = generated_text.find("```bash");
-            if (bash_start != std::string::npos) {
-                bash_start += 7; // Length of "```bash"
-                size_t bash_end = generated_text.find("```", bash_start);
-                if (bash_end != std::string::npos) {
-                    std::string command = generated_text.substr(bash_start, bash_end - bash_start);
-                    // Remove leading/trailing whitespace
-                    command.erase(0, command.find_first_not_of(" \t\n\r"));
-                    command.erase(command.find_last_not_of(" \t\n\r") + 1);
-                    return command;
+        while (!accepted && (running[0] || running[1])) {
+            int still_running = 0;
+            curl_multi_perform(multi, &still_running);
+            int queued = 0;
+            CURLMsg* message;
+            while (!accepted && (message = curl_multi_info_read(multi, &queued))) {
+                if (message->msg != CURLMSG_DONE) {
+                    continue;
                 }
+                int done = message->easy_handle == handles[0] ? 0 : 1;
+                CURLcode code = message->data.result;
+                curl_multi_remove_handle(multi, handles[done]);
+                running[done] = false;
+                race.slot = done;
+                race.result = code;
+                accepted = accept(done, code);
+            }
+            if (accepted || !running[0]) {
+                // A failed first request is retried, not hedged
+                break;
             }
             
-            // If no code blocks, try to extract first line that looks like a command
-            std::istringstream iss(generated_text);
-            std::string line;
-            while (std::getline(iss, line)) {
-                line.erase(0, line.find_first_not_of(" \t"));
-                if (!line.empty() && (line[0] == '$' || line.find_first_of("abcdefghijklmnopqrstuvwxyz") == 0)) {
-                    if (line[0] == '$') {
-                        line = line.substr(1);
-                        line.erase(0, line.find_first_not_of(" \t"));
+            int wait_ms = 1000;
+            if (hedge_pending) {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= hedge_at) {
+                    Log::at(LogLevel::Verbose) << "🏇 No answer after " << hedge_after_ms
+                                               << " ms; sending a hedged request" << std::endl;
+                    curl_multi_add_handle(multi, handles[1]);
+                    running[1] = true;
+                    race.hedged = true;
+                    hedge_pending = false;
+                    continue;
+                }
+                wait_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    hedge_at - now).count()) + 1;
+            }
+            curl_multi_poll(multi, nullptr, 0, wait_ms, nullptr);
+        }
+        
+        // The hedge may still be running after the first request failed
+        while (!accepted && running[1]) {
+            int still_running = 0;
+            curl_multi_perform(multi, &still_running);
+            int queued = 0;
+            CURLMsg* message;
+            while ((message = curl_multi_info_read(multi, &queued))) {
+                if (message->msg == CURLMSG_DONE && message->easy_handle == handles[1]) {
+                    CURLcode code = message->data.result;
+                    curl_multi_remove_handle(multi, handles[1]);
+                    running[1] = false;
+                    if (accept(1, code)) {
+                        accepted = true;
+                        race.slot = 1;
+                        race.result = code;
                     }
-                    return line;
+                    break;
                 }
             }
-            
-            return generated_text;
+            if (running[1]) {
+                curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+            }
         }
-    } catch (const std::exception& e) {
-        std::cerr << "Error parsing Gemini response: " << e.what() << std::endl;
+        
+        for (int i = 0; i < 2; ++i) {
+            if (running[i]) curl_multi_remove_handle(multi, handles[i]);
+        }
+        return race;
     }
     
-    return "";
+    // A single transfer on the multi handle
+    CURLcode perform(CURL* handle) {
+        CURL* const handles[2] = {handle, nullptr};
+        return perform(handles, 0, [](int, CURLcode) { return true; }).result;
+    }
+    
+    // New easy handle with the options every Gemini request uses
+    CURL* createHandle() {
+        CURL* handle = curl_easy_init();
+        if (!handle) return nullptr;
+        
+        if (share) curl_easy_setopt(handle, CURLOPT_SHARE, share);
+        curl_easy_setopt(handle, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "");
+        curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPIDLE, 60L);
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPINTVL, 30L);
+        curl_easy_setopt(handle, CURLOPT_DNS_CACHE_TIMEOUT, 600L);
+        if (connect_timeout_ms > 0) curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT_MS, connect_timeout_ms);
+        if (timeout_ms > 0) curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, timeout_ms);
+        if (!ca_bundle.empty()) curl_easy_setopt(handle, CURLOPT_CAINFO, ca_bundle.c_str());
+        if (Log::enabled(LogLevel::Trace)) {
+            curl_easy_setopt(handle, CURLOPT_VERBOSE, 1L);
+        }
+        return handle;
+    }
+    
+    static void lockShare(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+        static_cast<HttpSession*>(userptr)->share_locks[data].lock();
+    }
+    
+    static void unlockShare(CURL*, curl_lock_data data, void* userptr) {
+        static_cast<HttpSession*>(userptr)->share_locks[data].unlock();
+    }
+};
+
+GeminiClient::GeminiClient(const std::string& api_key) 
+    : api_key_(api_key), model_("gemini-pro"),
+      base_url_("https://generativelanguage.googleapis.com/v1beta"),
+      http_(std::make_unique<HttpSession>()) {
+}
+
+GeminiClient::~GeminiClient() {
+    cancelWarmup();
+    finishWarmup();
+}
+
+void GeminiClient::setBaseUrl(const std::string& base_url) {
+    base_url_ = base_url;
+}
+
+void GeminiClient::setStreaming(bool enabled) {
+    streaming_ = enabled;
+}
+
+void GeminiClient::setTimings(Timings* timings) {
+    timings_ = timings;
+}
+
+void GeminiClient::setLocalIntentThreshold(double threshold) {
+    local_intent_threshold_ = threshold;
+}
+
+void GeminiClient::setCaBundle(const std::string& path) {
+    http_->ca_bundle = path;
+    for (CURL* handle : {http_->curl, http_->hedge}) {
+        if (handle) curl_easy_setopt(handle, CURLOPT_CAINFO, path.c_str());
+    }
+}
+
+void GeminiClient::setContextTokenBudget(size_t tokens) {
+    context_collector_.setTokenBudget(tokens);
+}
+
+void GeminiClient::setResponseCache(std::unique_ptr<ResponseCache> cache) {
+    response_cache_ = std::move(cache);
+}
+
+void GeminiClient::setCacheLookups(bool enabled) {
+    cache_lookups_ = enabled;
+}
+
+void GeminiClient::acceptCommand(uint64_t key, const std::string& command) {
+    if (response_cache_ && key != 0) {
+        response_cache_->store(key, command);
+    }
+}
+
+void GeminiClient::declineCommand(uint64_t key) {
+    if (response_cache_ && key != 0) {
+        response_cache_->erase(key);
+    }
+}
+
+void GeminiClient::setCandidateCount(int count) {
+    candidate_count_ = std::max(count, 1);
+}
+
+void GeminiClient::setRequestPolicy(const RequestPolicy& policy) {
+    policy_ = policy;
+    policy_.max_retries = std::clamp(policy.max_retries, 0, RETRY_MAX_ATTEMPTS - 1);
+    policy_.retry_base_ms = std::clamp(policy.retry_base_ms, 0L, RETRY_CAP_MS);
+    // Batch and speculative requests get the same limits, without retries
+    http_->connect_timeout_ms = policy.connect_timeout_ms;
+    http_->timeout_ms = policy.deadline_ms;
+}
+
+long GeminiClient::connectionsOpened() const {
+    return connections_opened_;
+}
+
+long GeminiClient::lastHttpStatus() const {
+    return last_status_;
+}
+
+bool GeminiClient::apiKeyRejected() const {
+    return key_rejected_;
+}
+
+void GeminiClient::recordResponseStatus(long status, const std::string& body) {
+    last_status_ = status;
+    // Gemini answers a bad key with 400 API_KEY_INVALID; 401/403 cover revoked or unauthorized keys
+    if (status == 401 || status == 403 ||
+        (status == 400 && body.find("API_KEY_INVALID") != std::string::npos)) {
+        key_rejected_ = true;
+    } else if (status >= 200 && status < 300) {
+        key_rejected_ = false;
+    }
+}
+
+std::string GeminiClient::interpretCommand(const std::string& natural_language) {
+    candidates_.clear();
+    last_cache_key_ = 0;
+    
+    // A speculative translation of exactly this text saves most of the round trip
+    if (speculation_.valid()) {
+        std::shared_future<std::string> speculation = std::move(speculation_);
+        speculation_ = std::shared_future<std::string>();
+        if (speculation_query_ == natural_language) {
+            double head_start_ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - speculation_started_).count();
+            std::string command = speculation.get();
+            if (!command.empty()) {
+                last_cache_key_ = speculation_cache_key_;
+                if (timings_) timings_->setSource("speculation");
+                Log::at(LogLevel::Normal) << "\n⚡ Using the translation started while typing ("
+                                          << static_cast<long>(head_start_ms) << " ms head start)" << std::endl;
+                return command;
+            }
+        }
+    }
+    
+    // Common request shapes are answered locally when the match is confident
+    IntentEngine::Result local = intents_.match(natural_language);
+    if (local.confidence >= local_intent_threshold_) {
+        Log::at(LogLevel::Normal) << "\n⚡ Answered locally (" << local.intent << ", confidence "
+                  << static_cast<int>(local.confidence * 100) << "%)" << std::endl;
+        if (timings_) timings_->setSource("local");
+        return local.command;
+    }
+    
+    // Gather file system context while the connection is opened in the background
+    auto prepare_start = std::chrono::steady_clock::now();
+    startWarmup();
+    std::string fs_context = context_collector_.collect(natural_language);
+    double context_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - prepare_start).count();
+    if (timings_) timings_->add(Timings::Context, context_ms);
+    Log::at(LogLevel::Normal) << "\n📂 Analyzing file system context..." << std::endl;
+    Log::at(LogLevel::Verbose) << fs_context << std::endl;
+    
+    // Identical query, context and model: answer from the response cache
+    if (response_cache_) {
+        last_cache_key_ = ResponseCache::makeKey(model_, natural_language, fs_context);
+        std::string cached_command;
+        if (cache_lookups_ && response_cache_->lookup(last_cache_key_, cached_command)) {
+            ResponseCache::Stats stats = response_cache_->stats();
+            uint64_t total = stats.hits + stats.misses;
+            Log::at(LogLevel::Normal) << "⚡ Response cache hit (" << stats.hits << "/" << total << " = "
+                      << (total ? stats.hits * 100 / total : 0) << "% hit rate in "
+                      << response_cache_->path() << ")" << std::endl;
+            if (timings_) timings_->setSource("cache");
+            cancelWarmup();
+            return cached_command;
+        }
+    }
+    
+    std::string prompt;
+    {
+        Timings::Scope timer(timings_, Timings::Prompt);
+        prompt = buildPrompt(natural_language, fs_context);
+    }
+    const ContextCollector::Stats& context_stats = context_collector_.lastStats();
+    std::ostream& verbose = Log::at(LogLevel::Verbose);
+    verbose << "📏 Prompt: ~" << ContextCollector::estimateTokens(prompt) << " tokens (context "
+            << context_stats.raw_tokens << " → " << context_stats.tokens << " tokens";
+    if (context_stats.level > 0) {
+        verbose << ", compaction level " << context_stats.level;
+    }
+    verbose << ")" << std::endl;
+    
+    nlohmann::json request_json;
+    std::string request_body;
+    {
+        Timings::Scope timer(timings_, Timings::Serialize);
+        request_json = buildRequestJson(prompt, candidate_count_);
+        request_body = request_json.dump();
+    }
+    
+    // Print API request data. Pretty-printing the whole prompt is costly, so
+    // it only happens when shown.
+    Log::at(LogLevel::Normal) << "\n🌐 Calling Gemini API..." << std::endl;
+    if (Log::enabled(LogLevel::Verbose)) {
+        Log::at(LogLevel::Verbose) << "📤 Request Data:\n" << request_json.dump(2) << std::endl;
+    }
+    
+    // Everything up to here overlapped the warm-up; report how much of it was hidden
+    auto wait_start = std::chrono::steady_clock::now();
+    double prepare_ms = std::chrono::duration<double, std::milli>(wait_start - prepare_start).count();
+    finishWarmup();
+    double wait_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - wait_start).count();
+    if (warmup_ms_ > 0.0) {
+        // The warm-up did this request's DNS, connect and TLS
+        double connect_ms = warmup_timings_.get(Timings::Dns) + warmup_timings_.get(Timings::Connect) +
+                            warmup_timings_.get(Timings::Tls);
+        if (timings_) {
+            timings_->add(Timings::WarmupWait, wait_ms);
+            timings_->add(Timings::Dns, warmup_timings_.get(Timings::Dns));
+            timings_->add(Timings::Connect, warmup_timings_.get(Timings::Connect));
+            timings_->add(Timings::Tls, warmup_timings_.get(Timings::Tls));
+        }
+        Log::at(LogLevel::Verbose) << "⏱️  Context " << formatMs(context_ms) << ", prompt "
+                                   << formatMs(prepare_ms - context_ms) << " | warm-up "
+                                   << formatMs(warmup_ms_) << " (connect " << formatMs(connect_ms)
+                                   << ") | overlap " << formatMs(std::min(prepare_ms, warmup_ms_))
+                                   << ", waited " << formatMs(wait_ms) << std::endl;
+    } else {
+        Log::at(LogLevel::Verbose) << "⏱️  Context " << formatMs(context_ms) << ", prompt "
+                                   << formatMs(prepare_ms - context_ms) << " | connection already open"
+                                   << std::endl;
+    }
+    Log::at(LogLevel::Normal) << "\n⏳ Waiting for response...\n" << std::endl;
+    
+    // Cached by acceptCommand once the user has run it
+    return streaming_ && candidate_count_ == 1 ? interpretStreaming(request_body)
+                                               : interpretBuffered(request_body);
+}
+
+std::string GeminiClient::interpretBuffered(const std::string& request_body) {
+    std::string url = base_url_ + "/models/" + model_ + ":generateContent?key=" + api_key_;
+    std::string response = makeHttpRequest(url, request_body);
+    if (response.empty() && !last_error_.empty()) {
+        return "";
+    }
+    
+    // Print API response
+    Log::at(LogLevel::Normal) << "📥 Response received from Gemini API" << std::endl;
+    Log::at(LogLevel::Verbose) << "📄 Raw Response:\n" << response << std::endl;
+    Log::at(LogLevel::Normal) << "\n🔍 Parsing response...\n" << std::endl;
+    
+    if (candidate_count_ == 1) {
+        return commandFromResponse(response, timings_);
+    }
+    
+    // Dry-run every candidate and offer the best one first
+    std::vector<std::string> commands = commandsFromResponse(response, timings_);
+    {
+        Timings::Scope timer(timings_, Timings::Validate);
+        candidates_ = validator_.rank(commands);
+    }
+    if (Log::enabled(LogLevel::Verbose)) {
+        std::ostream& log = Log::at(LogLevel::Verbose);
+        log << "🧪 " << candidates_.size() << " distinct candidate(s) of " << commands.size() << ":" << std::endl;
+        for (const auto& candidate : candidates_) {
+            log << "   " << (candidate.viable() ? "✅ " : "⚠️  ") << candidate.command << std::endl;
+        }
+    }
+    return candidates_.empty() ? "" : candidates_[0].command;
+}
+
+AsyncHttpEngine& GeminiClient::asyncEngine() {
+    if (!async_engine_) {
+        // Engine handles share the session's DNS, TLS session and connection caches
+        async_engine_ = std::make_unique<AsyncHttpEngine>([this]() -> void* { return http_->createHandle(); });
+    }
+    return *async_engine_;
+}
+
+uint64_t GeminiClient::submitTranslation(const std::string& natural_language,
+                                         std::function<void(std::string)> done) {
+    // Local intents, context and cache lookups run on the caller's thread
+    IntentEngine::Result local = intents_.match(natural_language);
+    if (local.confidence >= local_intent_threshold_) {
+        done(local.command);
+        return 0;
+    }
+    
+    std::string fs_context = context_collector_.collect(natural_language);
+    uint64_t cache_key = 0;
+    if (response_cache_) {
+        cache_key = ResponseCache::makeKey(model_, natural_language, fs_context);
+        std::string cached_command;
+        if (cache_lookups_ && response_cache_->lookup(cache_key, cached_command)) {
+            done(cached_command);
+            return cache_key;
+        }
+    }
+    
+    std::string url = base_url_ + "/models/" + model_ + ":generateContent?key=" + api_key_;
+    std::string body = buildRequestJson(buildPrompt(natural_language, fs_context)).dump();
+    
+    // Nothing is stored here: speculations and batch answers were not accepted by anyone
+    asyncEngine().submit(url, body, [this, done](AsyncHttpEngine::Response response) {
+        connections_opened_ += response.connections_opened;
+        recordResponseStatus(response.status, response.body);
+        std::string command;
+        if (!response.error.empty()) {
+            reportError("Gemini request failed: " + response.error);
+        } else {
+            std::string error;
+            command = commandFromResponse(response.body, nullptr, &error);
+            if (!error.empty()) {
+                reportError(error);
+            }
+        }
+        done(command);
+    });
+    return cache_key;
+}
+
+void GeminiClient::setErrorHandler(std::function<void(const std::string&)> handler) {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    error_handler_ = std::move(handler);
+}
+
+void GeminiClient::reportError(const std::string& message) {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    if (error_handler_) {
+        error_handler_(message);
+    } else {
+        std::cerr << message << std::endl;
+    }
+}
+
+std::future<std::string> GeminiClient::interpretCommandAsync(const std::string& natural_language) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> future = promise->get_future();
+    submitTranslation(natural_language, [promise](std::string command) {
+        promise->set_value(std::move(command));
+    });
+    return future;
+}
+
+std::future<bool> GeminiClient::validateApiKeyAsync() {
+    auto promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> future = promise->get_future();
+    std::string url = base_url_ + "/models?key=" + api_key_;
+    
+    asyncEngine().submit(url, "", [this, promise](AsyncHttpEngine::Response response) {
+        connections_opened_ += response.connections_opened;
+        recordResponseStatus(response.status, response.body);
+        bool valid = false;
+        try {
+            valid = response.error.empty() && nlohmann::json::parse(response.body).contains("models");
+        } catch (const std::exception& e) {
+            valid = false;
+        }
+        promise->set_value(valid);
+    });
+    return future;
+}
+
+void GeminiClient::prefetchContext() {
+    // Rendering without a query lists the current directory and its subdirectories
+    startWarmup();
+    context_collector_.collect("");
+}
+
+void GeminiClient::startWarmup() {
+    // last_transfer_ belongs to the warm-up thread until it is joined
+    if (!http_->curl) {
+        return;
+    }
+    if (warmup_thread_.joinable()) {
+        if (!warmup_cancelled_) {
+            return;
+        }
+        // A cancelled warm-up stops at its next progress callback
+        warmup_thread_.join();
+    }
+    warmup_cancelled_ = false;
+    warmup_ms_ = 0.0;
+    warmup_timings_.reset();
+    auto started = std::chrono::steady_clock::now();
+    if (last_transfer_.time_since_epoch().count() != 0 && started - last_transfer_ < WARMUP_IDLE) {
+        return;
+    }
+    
+    warmup_thread_ = std::thread([this, started]() {
+        // HEAD of the API root: DNS, TCP and TLS without sending the key
+        CURL* curl = http_->curl;
+        std::string discarded;
+        curl_easy_setopt(curl, CURLOPT_URL, base_url_.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &discarded);
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, WarmupProgress);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &warmup_cancelled_);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, std::min(WARMUP_TIMEOUT_MS, policy_.deadline_ms));
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, policy_.connect_timeout_ms);
+        if (http_->perform(curl) == CURLE_OK) {
+            long new_connections = 0;
+            curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &new_connections);
+            connections_opened_ += new_connections;
+            recordTransferTimes(curl, &warmup_timings_);
+            last_transfer_ = std::chrono::steady_clock::now();
+        }
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 0L);
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, 0L);
+        warmup_ms_ = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - started).count();
+    });
+}
+
+void GeminiClient::cancelWarmup() {
+    if (warmup_thread_.joinable()) {
+        warmup_cancelled_ = true;
+    }
+}
+
+void GeminiClient::finishWarmup() {
+    if (warmup_thread_.joinable()) {
+        warmup_thread_.join();
+    }
+}
+
+void GeminiClient::speculate(const std::string& natural_language) {
+    if (natural_language == speculation_query_ && speculation_.valid()) {
+        return;
+    }
+    // A single word is rarely the finished request
+    if (natural_language.find(' ') == std::string::npos) {
+        return;
+    }
+    
+    // An earlier speculation still in flight finishes on its own and is dropped
+    auto promise = std::make_shared<std::promise<std::string>>();
+    speculation_query_ = natural_language;
+    speculation_ = promise->get_future().share();
+    speculation_started_ = std::chrono::steady_clock::now();
+    speculation_cache_key_ = submitTranslation(natural_language, [promise](std::string command) {
+        promise->set_value(std::move(command));
+    });
+}
+
+std::vector<std::string> GeminiClient::interpretBatch(const std::vector<std::string>& queries,
+                                                      size_t max_in_flight) {
+    std::vector<std::future<std::string>> futures;
+    futures.reserve(queries.size());
+    
+    asyncEngine().setMaxInFlight(max_in_flight);
+    Log::at(LogLevel::Normal) << "\n🌐 Translating " << queries.size() << " request(s) with up to "
+                              << std::max<size_t>(1, max_in_flight) << " in flight..." << std::endl;
+    
+    for (size_t i = 0; i < queries.size(); ++i) {
+        auto promise = std::make_shared<std::promise<std::string>>();
+        futures.push_back(promise->get_future());
+        std::string label = "[" + std::to_string(i + 1) + "/" + std::to_string(queries.size()) + "] ";
+        submitTranslation(queries[i], [promise, label](std::string command) {
+            Log::at(LogLevel::Normal) << "📥 " << label << (command.empty() ? "(no command)" : command) << std::endl;
+            promise->set_value(std::move(command));
+        });
+    }
+    
+    // Results come back in completion order but are returned in submission order
+    std::vector<std::string> commands;
+    commands.reserve(queries.size());
+    for (auto& future : futures) {
+        commands.push_back(future.get());
+    }
+    return commands;
+}
+
+std::string GeminiClient::interpretStreaming(const std::string& request_body) {
+    finishWarmup();
+    std::string url = base_url_ + "/models/" + model_ + ":streamGenerateContent?alt=sse&key=" + api_key_;
+    
+    StreamState states[2];
+    int slot = sendRequest([&](void* handle, int slot) {
+        CURL* curl = static_cast<CURL*>(handle);
+        states[slot] = StreamState();
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, StreamCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &states[slot]);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(request_body.size()));
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request_body.c_str());
+    }, [&](int slot) { return states[slot].complete; }, true);
+    if (slot < 0) {
+        return "";
+    }
+    
+    StreamState& state = states[slot];
+    recordResponseStatus(last_status_, state.raw);
+    if (state.complete) {
+        Log::at(LogLevel::Normal) << "📥 Command received from Gemini stream (rest of response cancelled)" << std::endl;
+        return state.command;
+    }
+    
+    // Stream ended without a fenced block; fall back to the full text
+    state.feed("\n", 1);
+    state.dispatchEvent();
+    Log::at(LogLevel::Normal) << "📥 Response streamed from Gemini API" << std::endl;
+    Log::at(LogLevel::Verbose) << "📄 Raw Response:\n" << state.raw << std::endl;
+    Log::at(LogLevel::Normal) << "\n🔍 Parsing response...\n" << std::endl;
+    
+    if (state.text.empty()) {
+        return "";
+    }
+    Timings::Scope timer(timings_, Timings::Extract);
+    return extractCommand(state.text);
 }
 
 bool GeminiClient::validateApiKey() {
-    std::string url = "https://generativelanguage.googleapis.com/v1beta/models?key=" + api_key_;
+    std::string url = base_url_ + "/models?key=" + api_key_;
     std::string response = makeHttpRequest(url, "");
     
     try {
@@ -207,36 +1000,157 @@ bool GeminiClient::validateApiKey() {
 }
 
 std::string GeminiClient::makeHttpRequest(const std::string& url, const std::string& data) {
-    CURL* curl;
-    CURLcode res;
-    std::string response_data;
+    finishWarmup();
     
-    curl = curl_easy_init();
-    if (curl) {
-        struct curl_slist* headers = nullptr;
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-        
+    // Only generation is hedged; a key check is cheap and quick
+    std::string responses[2];
+    int slot = sendRequest([&](void* handle, int slot) {
+        CURL* curl = static_cast<CURL*>(handle);
+        responses[slot].clear();
         curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_data);
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        
-        if (!data.empty()) {
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responses[slot]);
+        if (data.empty()) {
+            curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+        } else {
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(data.size()));
             curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
         }
+    }, nullptr, !data.empty());
+    if (slot < 0) {
+        return "";
+    }
+    
+    recordResponseStatus(last_status_, responses[slot]);
+    return responses[slot];
+}
+
+long GeminiClient::hedgeDelayMs() const {
+    if (policy_.hedge_after_ms >= 0) {
+        return policy_.hedge_after_ms;
+    }
+    // Automatic: the p95 of recent calls, once there are enough of them
+    if (latencies_.size() < HEDGE_MIN_SAMPLES) {
+        return 0;
+    }
+    std::vector<double> sorted(latencies_.begin(), latencies_.end());
+    size_t index = (sorted.size() * 95 + 99) / 100 - 1;
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return static_cast<long>(sorted[index]) + 1;
+}
+
+int GeminiClient::sendRequest(const std::function<void(void*, int)>& setup,
+                              const std::function<bool(int)>& complete, bool hedge) {
+    last_error_.clear();
+    if (!http_->curl) {
+        last_error_ = "libcurl could not be initialized";
+        return -1;
+    }
+    
+    static thread_local std::mt19937 random(std::random_device{}());
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(policy_.deadline_ms);
+    long hedge_after_ms = hedge ? hedgeDelayMs() : 0;
+    
+    for (int attempt = 1;; ++attempt) {
+        auto attempt_start = std::chrono::steady_clock::now();
+        long remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - attempt_start).count();
+        if (remaining <= 0) {
+            last_error_ = "no answer within " + std::to_string(policy_.deadline_ms) + " ms";
+            return -1;
+        }
         
-        res = curl_easy_perform(curl);
+        // Each attempt gets what is left of the deadline
+        CURL* handles[2] = {http_->curl, nullptr};
+        if (hedge_after_ms > 0 && hedge_after_ms < remaining) {
+            handles[1] = http_->hedgeHandle();
+        }
+        for (int slot = 0; slot < 2 && handles[slot]; ++slot) {
+            long timeout = slot == 0 ? remaining : remaining - hedge_after_ms;
+            curl_easy_setopt(handles[slot], CURLOPT_TIMEOUT_MS, timeout);
+            curl_easy_setopt(handles[slot], CURLOPT_CONNECTTIMEOUT_MS, std::min(policy_.connect_timeout_ms, timeout));
+            setup(handles[slot], slot);
+        }
         
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
+        // A finished transfer is the answer unless it failed in a way that may pass
+        HttpSession::Race race = http_->perform(handles, hedge_after_ms, [&](int done, CURLcode code) {
+            if (complete && complete(done)) {
+                return true;
+            }
+            long status = 0;
+            curl_easy_getinfo(handles[done], CURLINFO_RESPONSE_CODE, &status);
+            return code == CURLE_OK && !retryableStatus(status);
+        });
+        double attempt_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - attempt_start).count();
+        bool accepted = race.accepted;
+        int slot = race.slot;
+        CURLcode result = race.result;
+        
+        for (int sent = 0; sent < (race.hedged ? 2 : 1); ++sent) {
+            long new_connections = 0;
+            if (curl_easy_getinfo(handles[sent], CURLINFO_NUM_CONNECTS, &new_connections) == CURLE_OK) {
+                connections_opened_ += new_connections;
+            }
+        }
+        CURL* handle = handles[slot];
+        long status = 0;
+        curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &status);
+        last_status_ = status;
+        
+        if (accepted) {
+            recordTransferTimes(handle, timings_);
+            // A transfer cut short may have closed its connection (HTTP/1.1)
+            if (result == CURLE_OK) {
+                last_transfer_ = std::chrono::steady_clock::now();
+            }
+            if (slot == 1) {
+                Log::at(LogLevel::Verbose) << "🏁 The hedged request answered first" << std::endl;
+            }
+            if (status >= 400) {
+                last_error_ = "HTTP " + std::to_string(status);
+            } else if (hedge) {
+                latencies_.push_back(attempt_ms);
+                if (latencies_.size() > HEDGE_SAMPLES) latencies_.pop_front();
+            }
+            return slot;
+        }
         
-        if (res != CURLE_OK) {
-            std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << std::endl;
-            return "";
+        // The first request's timeout is the rest of the deadline
+        if (result == CURLE_OPERATION_TIMEDOUT && attempt_ms + 1.0 >= remaining) {
+            last_error_ = "no answer within " + std::to_string(policy_.deadline_ms) + " ms";
+            return -1;
+        }
+        std::string failure = result != CURLE_OK ? curl_easy_strerror(result) : "HTTP " + std::to_string(status);
+        bool retryable = result != CURLE_OK ? retryableTransfer(result) : retryableStatus(status);
+        if (!retryable || attempt > policy_.max_retries) {
+            last_error_ = attempt > 1 ? failure + " after " + std::to_string(attempt) + " attempts" : failure;
+            return -1;
         }
+        
+        // Full jitter: anywhere up to a ceiling that doubles per retry, but
+        // never before the server's Retry-After. setRequestPolicy keeps the
+        // base within RETRY_CAP_MS, so the shift cannot overflow, and neither
+        // wait is allowed to grow past the time left.
+        remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        long ceiling = std::min(RETRY_CAP_MS, policy_.retry_base_ms << std::min(attempt - 1, RETRY_MAX_DOUBLINGS));
+        ceiling = std::max(0L, std::min(ceiling, remaining));
+        long wait_ms = std::uniform_int_distribution<long>(0, ceiling)(random);
+        curl_off_t retry_after = 0;
+        if (curl_easy_getinfo(handle, CURLINFO_RETRY_AFTER, &retry_after) == CURLE_OK && retry_after > 0) {
+            curl_off_t limit_s = std::max(0L, remaining) / 1000 + 1;
+            wait_ms = std::max<long>(wait_ms, static_cast<long>(std::min(retry_after, limit_s)) * 1000);
+        }
+        if (wait_ms >= remaining) {
+            last_error_ = failure + "; the next retry (in " + std::to_string(wait_ms) +
+                          " ms) would miss the " + std::to_string(policy_.deadline_ms) + " ms deadline";
+            return -1;
+        }
+        Log::at(LogLevel::Normal) << "🔁 " << failure << "; retrying in " << wait_ms << " ms (attempt "
+                                  << attempt + 1 << " of " << policy_.max_retries + 1 << ")" << std::endl;
+        Timings::Scope timer(timings_, Timings::Backoff);
+        std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));
     }
-    
-    return response_data;
 }
 
 std::string GeminiClient::buildPrompt(const std::string& user_input, const std::string& fs_context) {
@@ -2,7 +2,6 @@
 #include <iostream>
 #include <sstream>
 #include <algorithm>
-#include <regex>
 #include <cstdio>
 #include <vector>
 #include <set>
@@ -58,18 +57,25 @@ std::string getFileSystemContext(const std::string& query) {
         context += files_list;
     }
     
-    // Extract potential directory names from query and show their contents
-    std::regex dir_pattern(R"(\b(test|dir1|dir2|downloads?|documents?|backup|temp|home|desktop)\b)");
-    std::smatch match;
-    std::string lower_query = query;
-    std::transform(lower_query.begin(), lower_query.end(), lower_query.begin(), ::tolower);
-    
-    std::set<std::string> found_dirs;
-    std::string::const_iterator searchStart(lower_query.cbegin());
-    while (std::regex_search(searchStart, lower_query.cend(), match, dir_pattern)) {
-        found_dirs.insert(match[0].str());
-        searchStart = match.suffix().first;
+    // Index the directory names from the tree ("./a/b" lines) and match the query against them,
+    // keeping the usual suspects (downloads, backup, ...) so a missing one is reported
+    DirectoryIndex index;
+    std::istringstream tree_lines(tree);
+    std::string line;
+    while (std::getline(tree_lines, line)) {
+        line.erase(line.find_last_not_of("\r") + 1);
+        if (line.compare(0, 2, "./") == 0 && line.size() > 2) {
+            index.add(line.substr(2));
+        }
+    }
+    QueryText query_text(query);
+    std::vector<std::string> mentioned = index.match(query_text, 8);
+    for (const auto& name : query_text.mentionedDirectories()) {
+        if (!index.contains(name) && std::find(mentioned.begin(), mentioned.end(), name) == mentioned.end()) {
+            mentioned.push_back(name);
+        }
     }
+    std::set<std::string> found_dirs(mentioned.begin(), mentioned.end());
     
     // List files in specifically mentioned directories
     if (!found_dirs.empty()) {
@@ -88,168 +94,76 @@ std::string getFileSystemContext(const std::string& query) {
     return context;
 }
 
+// The simple client makes no HTTP calls, so there is no transport state
+struct GeminiClient::HttpSession {};
+
 GeminiClient::GeminiClient(const std::string& api_key) 
     : api_key_(api_key), model_("gemini-pro") {
 }
 
-std::string extractDirectoryName(const std::string& text, const std::string& keyword) {
-    // Try to find "the <name> directory" or "into <name>" or "from <name>"
-    std::regex dir_pattern(keyword + R"(\s+(?:the\s+)?(\w+)\s+(?:directory|dir|folder))");
-    std::smatch match;
-    if (std::regex_search(text, match, dir_pattern)) {
-        return match[1].str();
-    }
-    return "";
+GeminiClient::~GeminiClient() = default;
+
+void GeminiClient::setBaseUrl(const std::string& base_url) {
+    base_url_ = base_url;
 }
 
-std::string extractNestedPath(const std::string& text, const std::string& dir_name) {
-    // Check if directory is nested: "dir1 in test", "dir1 directory in test", etc.
-    std::regex nested_pattern(dir_name + R"(\s+(?:directory|dir|folder)?\s+in\s+(?:the\s+)?(\w+))");
-    std::smatch match;
-    if (std::regex_search(text, match, nested_pattern)) {
-        // Found "dir1 in test" -> return "test/dir1" (Unix-style path)
-        return match[1].str() + "/" + dir_name;
-    }
-    return dir_name;
+void GeminiClient::setStreaming(bool enabled) {
+    streaming_ = enabled;
+}
+
+void GeminiClient::setTimings(Timings* timings) {
+    timings_ = timings;
+}
+
+long GeminiClient::connectionsOpened() const {
+    return connections_opened_;
+}
+
+long GeminiClient::lastHttpStatus() const {
+    return last_status_;
+}
+
+bool GeminiClient::apiKeyRejected() const {
+    return key_rejected_;
+}
+
+void GeminiClient::setLocalIntentThreshold(double threshold) {
+    local_intent_threshold_ = threshold;
 }
 
 std::string GeminiClient::interpretCommand(const std::string& natural_language) {
     // Gather and display file system context
-    std::string context = getFileSystemContext(natural_language);
-    std::cout << "\n📂 Analyzing file system context..." << std::endl;
-    std::cout << context << std::endl;
+    std::string context;
+    {
+        Timings::Scope timer(timings_, Timings::Context);
+        context = getFileSystemContext(natural_language);
+    }
+    Log::at(LogLevel::Normal) << "\n📂 Analyzing file system context..." << std::endl;
+    Log::at(LogLevel::Verbose) << context << std::endl;
     
     // For demo purposes, return a simple command based on keywords
     // In a real implementation, this would call the Gemini API with this context
-    
-    std::string lower_input = natural_language;
-    std::transform(lower_input.begin(), lower_input.end(), lower_input.begin(), ::tolower);
-    
-    // Enhanced pattern matching
-    
-    // Move files command - extract source and destination directories
-    if (lower_input.find("move") != std::string::npos && 
-        (lower_input.find("directory") != std::string::npos || lower_input.find("dir") != std::string::npos)) {
-        
-        std::string source_dir = extractDirectoryName(lower_input, "(?:in|from)");
-        std::string dest_dir = extractDirectoryName(lower_input, "(?:into|to)");
-        
-        // Fallback: try to extract directory names without keywords
-        if (source_dir.empty() || dest_dir.empty()) {
-            std::regex simple_dir(R"(\b(test|dir1|dir2|documents?|downloads?|backup|temp)\b)");
-            std::smatch match;
-            std::string::const_iterator searchStart(lower_input.cbegin());
-            std::vector<std::string> dirs;
-            
-            while (std::regex_search(searchStart, lower_input.cend(), match, simple_dir)) {
-                dirs.push_back(match[0].str());
-                searchStart = match.suffix().first;
-            }
-            
-            if (dirs.size() >= 2) {
-                source_dir = dirs[0];
-                dest_dir = dirs[1];
-            }
-        }
-        
-        // Check if destination is nested inside another directory
-        if (!dest_dir.empty()) {
-            dest_dir = extractNestedPath(lower_input, dest_dir);
-        }
-        
-        // Check if we also need to display contents
-        bool display_after = (lower_input.find("display") != std::string::npos || 
-                             lower_input.find("show") != std::string::npos ||
-                             lower_input.find("list") != std::string::npos) &&
-                            (lower_input.find("then") != std::string::npos || 
-                             lower_input.find("and") != std::string::npos);
-        
-        if (!source_dir.empty() && !dest_dir.empty()) {
-            // Check if destination is a subdirectory of source (nested structure)
-            bool is_nested = (dest_dir.find(source_dir + "/") == 0);
-            
-            std::string command;
-            if (is_nested) {
-                // For nested moves, only move files (not subdirectories) to avoid recursion
-                // Use find to get only files, then mv them
-                command = "find " + source_dir + "/ -maxdepth 1 -type f -exec mv {} " + dest_dir + "/ \\;";
-            } else {
-                // For non-nested moves, move everything
-                command = "mv " + source_dir + "/* " + dest_dir + "/";
-            }
-            
-            if (display_after) {
-                command += " && ls -la " + dest_dir;
-            }
-            return command;
-        }
-    }
-    
-    // List/display directory contents
-    if ((lower_input.find("list") != std::string::npos || 
-         lower_input.find("display") != std::string::npos || 
-         lower_input.find("show") != std::string::npos) && 
-        (lower_input.find("file") != std::string::npos || 
-         lower_input.find("content") != std::string::npos ||
-         lower_input.find("directory") != std::string::npos)) {
-        
-        // Check if user means current directory
-        if (lower_input.find("current") != std::string::npos || 
-            lower_input.find("this") != std::string::npos ||
-            lower_input.find("the directory") != std::string::npos ||
-            lower_input.find("here") != std::string::npos) {
-            return "ls -la";
-        }
-        
-        std::string dir_name = extractDirectoryName(lower_input, "(?:of|in)");
-        if (dir_name.empty()) {
-            // Try to find any directory name (excluding common words)
-            std::regex simple_dir(R"(\b(test|dir1|dir2|documents?|downloads?|backup|temp|home|desktop)\b)");
-            std::smatch match;
-            if (std::regex_search(lower_input, match, simple_dir)) {
-                dir_name = match[0].str();
-            }
-        }
-        
-        // Check if it's a nested path
-        if (!dir_name.empty()) {
-            dir_name = extractNestedPath(lower_input, dir_name);
-            return "ls -la " + dir_name;
-        }
-        return "ls -la";
-    }
-    
-    // Find PDFs
-    if (lower_input.find("find") != std::string::npos && lower_input.find("pdf") != std::string::npos) {
-        return "find . -name '*.pdf' -type f";
-    }
-    
-    // Zip files
-    if (lower_input.find("zip") != std::string::npos && lower_input.find("pdf") != std::string::npos) {
-        return "zip documents.zip *.pdf";
-    }
-    
-    // Move txt files (legacy)
-    if (lower_input.find("move") != std::string::npos && lower_input.find("txt") != std::string::npos) {
-        return "mv *.txt Documents/notes/";
-    }
-    
-    // Delete temp files
-    if (lower_input.find("delete") != std::string::npos && 
-        (lower_input.find("temp") != std::string::npos || lower_input.find("temporary") != std::string::npos)) {
-        return "rm -rf *.tmp";
-    }
-    
-    // Start server
-    if ((lower_input.find("server") != std::string::npos || lower_input.find("serve") != std::string::npos) && 
-        lower_input.find("http") != std::string::npos) {
-        return "python -m http.server 8080";
+    // There is no API to fall back on here, so any match is used
+    if (timings_) timings_->setSource("local");
+    IntentEngine::Result local = intents_.match(natural_language);
+    if (!local.command.empty()) {
+        return local.command;
     }
     
     // Default
     return "echo 'Command not recognized. Try: move files from dir1 to dir2, list files in dir1, find PDFs, etc.'";
 }
 
+std::vector<std::string> GeminiClient::interpretBatch(const std::vector<std::string>& queries,
+                                                      size_t /*max_in_flight*/) {
+    // Keyword matching is local, so there is nothing to overlap
+    std::vector<std::string> commands;
+    for (const auto& query : queries) {
+        commands.push_back(interpretCommand(query));
+    }
+    return commands;
+}
+
 bool GeminiClient::validateApiKey() {
     // For demo purposes, always return true
     return !api_key_.empty();
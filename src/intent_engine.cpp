@@ -0,0 +1,377 @@
+#include "ganpi.h"
+#include <algorithm>
+#include <cctype>
+#include <set>
+
+namespace ganpi {
+
+namespace {
+
+// Words every intent can absorb without making the request look unusual
+const std::set<std::string> FILLER_WORDS = {
+    "a", "an", "the", "all", "of", "in", "on", "at", "to", "into", "from", "for", "me", "my",
+    "please", "can", "could", "would", "you", "i", "want", "need", "just", "and", "then",
+    "with", "that", "which", "is", "are", "what", "whats", "it", "them", "this", "these",
+    "those", "show", "list", "display", "give", "tell", "get", "print", "now", "here"
+};
+
+const std::set<std::string> EXTENSIONS = {
+    "pdf", "txt", "md", "csv", "json", "xml", "yaml", "yml", "log", "jpg", "jpeg", "png",
+    "gif", "svg", "mp3", "mp4", "zip", "tar", "gz", "py", "js", "ts", "c", "cpp", "h",
+    "hpp", "java", "go", "rs", "sh", "html", "css", "doc", "docx", "xls", "xlsx"
+};
+
+struct Query {
+    explicit Query(const std::string& request) : words(request) {}
+    
+    std::string text;                   // lowercased request
+    std::vector<std::string> tokens;    // lowercased words
+    QueryText words;                    // phrase matchers over the same request
+
+    bool has(const char* fragment) const {
+        return text.find(fragment) != std::string::npos;
+    }
+    bool hasToken(const std::string& word) const {
+        return std::find(tokens.begin(), tokens.end(), word) != tokens.end();
+    }
+};
+
+// One request shape: a base confidence, the words it accounts for and a
+// builder that returns the command, or "" when the request does not fit
+struct IntentRule {
+    const char* name;
+    double confidence;
+    const char* vocabulary;
+    std::string (*build)(const Query& query);
+};
+
+std::vector<std::string> splitWords(const std::string& text) {
+    std::vector<std::string> words;
+    std::string word;
+    for (char c : text) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (std::isalnum(u) || c == '_' || c == '-' || c == '.' || c == '/' || c == '*') {
+            word += c;
+        } else if (c != '\'') {
+            if (!word.empty()) words.push_back(word);
+            word.clear();
+        }
+    }
+    if (!word.empty()) words.push_back(word);
+    // Trailing sentence punctuation is not part of the word
+    for (auto& w : words) {
+        while (w.size() > 1 && (w.back() == '.' || w.back() == '/')) w.pop_back();
+    }
+    return words;
+}
+
+// The word right after any of the given markers, e.g. "called <name>"
+std::string wordAfter(const Query& query, std::initializer_list<const char*> markers) {
+    for (size_t i = 0; i + 1 < query.tokens.size(); ++i) {
+        for (const char* marker : markers) {
+            if (query.tokens[i] == marker && !FILLER_WORDS.count(query.tokens[i + 1])) {
+                return query.tokens[i + 1];
+            }
+        }
+    }
+    return "";
+}
+
+bool isSafeName(const std::string& name) {
+    return !name.empty() && name[0] != '-' &&
+           std::all_of(name.begin(), name.end(), [](char c) {
+               return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-' ||
+                      c == '.' || c == '/';
+           });
+}
+
+std::string buildMoveDirectory(const Query& q) {
+    if (!q.has("move") || !(q.has("directory") || q.has("dir"))) {
+        return "";
+    }
+    std::string source_dir = q.words.directoryAfter({"in", "from"});
+    std::string dest_dir = q.words.directoryAfter({"into", "to"});
+
+    // Fallback: directory names without keywords
+    if (source_dir.empty() || dest_dir.empty()) {
+        std::vector<std::string> dirs = q.words.mentionedDirectories(false);
+        if (dirs.size() >= 2) {
+            source_dir = dirs[0];
+            dest_dir = dirs[1];
+        }
+    }
+    if (source_dir.empty() || dest_dir.empty()) {
+        return "";
+    }
+    dest_dir = q.words.nestedPath(dest_dir);
+
+    std::string command;
+    if (dest_dir.find(source_dir + "/") == 0) {
+        // Moving into a subdirectory of the source: only move files to avoid recursion
+        command = "find " + source_dir + "/ -maxdepth 1 -type f -exec mv {} " + dest_dir + "/ \\;";
+    } else {
+        command = "mv " + source_dir + "/* " + dest_dir + "/";
+    }
+    bool display_after = (q.has("display") || q.has("show") || q.has("list")) &&
+                         (q.has("then") || q.has("and"));
+    if (display_after) {
+        command += " && ls -la " + dest_dir;
+    }
+    return command;
+}
+
+std::string buildList(const Query& q) {
+    if (q.hasToken("move")) {
+        return ""; // "move ... and then list" belongs to move_directory
+    }
+    if (!(q.has("list") || q.has("display") || q.has("show")) ||
+        !(q.has("file") || q.has("content") || q.has("directory"))) {
+        return "";
+    }
+    if (q.has("current") || q.has("this") || q.has("the directory") || q.has("here")) {
+        return "ls -la";
+    }
+    std::string dir_name = q.words.directoryAfter({"of", "in"});
+    if (dir_name.empty()) {
+        std::vector<std::string> dirs = q.words.mentionedDirectories();
+        if (!dirs.empty()) {
+            dir_name = dirs[0];
+        }
+    }
+    if (!dir_name.empty()) {
+        return "ls -la " + q.words.nestedPath(dir_name);
+    }
+    return "ls -la";
+}
+
+std::string buildFindByExtension(const Query& q) {
+    if (!(q.hasToken("find") || q.hasToken("search") || q.hasToken("locate"))) {
+        return "";
+    }
+    for (const auto& token : q.tokens) {
+        std::string ext = token;
+        if (ext.compare(0, 2, "*.") == 0) ext = ext.substr(2);
+        else if (ext[0] == '.') ext = ext.substr(1);
+        if (ext.size() > 1 && ext.back() == 's' && EXTENSIONS.count(ext.substr(0, ext.size() - 1))) {
+            ext.pop_back(); // "pdfs"
+        }
+        if (EXTENSIONS.count(ext)) {
+            return "find . -name '*." + ext + "' -type f";
+        }
+    }
+    return "";
+}
+
+std::string buildZipPdf(const Query& q) {
+    return q.has("zip") && q.has("pdf") ? "zip documents.zip *.pdf" : "";
+}
+
+std::string buildMoveTxt(const Query& q) {
+    return q.has("move") && q.has("txt") ? "mv *.txt Documents/notes/" : "";
+}
+
+std::string buildDeleteTemp(const Query& q) {
+    return q.has("delete") && (q.has("temp") || q.has("temporary")) ? "rm -rf *.tmp" : "";
+}
+
+std::string buildHttpServer(const Query& q) {
+    if (!(q.has("server") || q.has("serve")) || !q.has("http")) {
+        return "";
+    }
+#ifdef _WIN32
+    return "python -m http.server 8080";
+#else
+    return "python3 -m http.server 8080";
+#endif
+}
+
+std::string buildWorkingDirectory(const Query& q) {
+    if (q.has("where am i") || q.has("working directory") || q.hasToken("pwd") ||
+        ((q.hasToken("which") || q.hasToken("what") || q.hasToken("whats")) &&
+         q.hasToken("current") && (q.hasToken("directory") || q.hasToken("folder") || q.hasToken("path")))) {
+        return "pwd";
+    }
+    return "";
+}
+
+std::string buildDiskFree(const Query& q) {
+    if (q.has("disk space") || q.has("free space") || q.has("disk usage") || q.has("space left")) {
+        return "df -h";
+    }
+    return "";
+}
+
+std::string buildDirectorySize(const Query& q) {
+    if (!(q.has("size of") || q.has("how big") || q.has("how large")) ||
+        !(q.has("directory") || q.has("folder") || q.hasToken("this"))) {
+        return "";
+    }
+    std::string dir = wordAfter(q, {"of"});
+    if (dir == "directory" || dir == "folder" || dir == "current") dir.clear();
+    return "du -sh " + (isSafeName(dir) ? dir : std::string("."));
+}
+
+std::string buildLargestFiles(const Query& q) {
+    if ((q.has("largest") || q.has("biggest")) && q.has("file")) {
+        return "du -ah . | sort -rh | head -n 10";
+    }
+    return "";
+}
+
+std::string buildRecentFiles(const Query& q) {
+    if ((q.has("recent") || q.has("newest") || q.has("latest") || q.has("last modified")) &&
+        q.has("file")) {
+        return "ls -lt | head -n 10";
+    }
+    return "";
+}
+
+std::string buildCountFiles(const Query& q) {
+    if ((q.has("how many files") || (q.hasToken("count") && q.has("file")))) {
+        return "find . -maxdepth 1 -type f | wc -l";
+    }
+    return "";
+}
+
+std::string buildMakeDirectory(const Query& q) {
+    if (!(q.hasToken("create") || q.hasToken("make") || q.hasToken("new")) ||
+        !(q.hasToken("directory") || q.hasToken("folder") || q.hasToken("dir"))) {
+        return "";
+    }
+    std::string name = wordAfter(q, {"called", "named"});
+    if (name.empty()) {
+        name = wordAfter(q, {"directory", "folder", "dir"});
+    }
+    return isSafeName(name) ? "mkdir -p " + name : "";
+}
+
+std::string buildGitStatus(const Query& q) {
+    if (q.has("git status") || (q.hasToken("status") && (q.hasToken("git") || q.has("repo")))) {
+        return "git status";
+    }
+    return "";
+}
+
+std::string buildGitLog(const Query& q) {
+    if (q.has("commit") && (q.has("recent") || q.has("last") || q.has("history") || q.hasToken("log"))) {
+        return "git log --oneline -n 10";
+    }
+    return "";
+}
+
+std::string buildProcesses(const Query& q) {
+    if (q.has("running processes") || (q.has("process") && (q.has("list") || q.has("show")))) {
+        return "ps aux";
+    }
+    return "";
+}
+
+std::string buildMemory(const Query& q) {
+    if (q.has("memory usage") || q.has("free memory") || q.hasToken("ram") || q.has("how much memory")) {
+#ifdef __APPLE__
+        return "vm_stat";
+#else
+        return "free -h";
+#endif
+    }
+    return "";
+}
+
+std::string buildDate(const Query& q) {
+    if (q.has("what time") || q.has("current time") || q.has("today's date") ||
+        q.has("todays date") || q.has("what day") || q.has("current date")) {
+        return "date";
+    }
+    return "";
+}
+
+std::string buildWhoami(const Query& q) {
+    if (q.has("who am i") || q.has("current user") || q.has("my username") || q.has("logged in as")) {
+        return "whoami";
+    }
+    return "";
+}
+
+// The request shapes answered locally. Confidence reflects how reliably the
+// builder's command matches what people mean by that shape.
+const IntentRule INTENT_RULES[] = {
+    {"move_directory", 0.80, "move moving files file everything contents content directory dir folder",
+        buildMoveDirectory},
+    {"list_directory", 0.95, "files file contents content directory dir folder current everything inside",
+        buildList},
+    {"find_by_extension", 0.95, "find search locate files file every document documents", buildFindByExtension},
+    {"zip_pdf", 0.85, "zip compress pdf pdfs files file", buildZipPdf},
+    {"move_txt", 0.50, "move txt files file", buildMoveTxt},
+    {"delete_temp", 0.60, "delete remove temp temporary files file", buildDeleteTemp},
+    {"http_server", 0.95, "start run http server serve simple web local", buildHttpServer},
+    {"working_directory", 0.95, "where am i working directory current folder path pwd", buildWorkingDirectory},
+    {"disk_free", 0.95, "disk space free usage left how much available", buildDiskFree},
+    {"directory_size", 0.90, "size how big large directory folder current", buildDirectorySize},
+    {"largest_files", 0.90, "largest biggest files file", buildLargestFiles},
+    {"recent_files", 0.90, "recent recently newest latest last modified changed files file", buildRecentFiles},
+    {"count_files", 0.90, "how many count number files file there", buildCountFiles},
+    {"make_directory", 0.90, "create make new directory folder dir called named", buildMakeDirectory},
+    {"git_status", 0.95, "git status repo repository", buildGitStatus},
+    {"git_log", 0.90, "recent last commits commit history log git", buildGitLog},
+    {"processes", 0.90, "running processes process", buildProcesses},
+    {"memory", 0.90, "memory usage free ram how much", buildMemory},
+    {"date", 0.95, "what time current today's todays date day it", buildDate},
+    {"whoami", 0.95, "who am i current user username logged as", buildWhoami},
+};
+
+std::string singular(const std::string& word) {
+    if (word.size() > 3 && word.back() == 's') {
+        return word.substr(0, word.size() - 1);
+    }
+    return word;
+}
+
+// Share of the request's words that the intent accounts for. Unexplained
+// words ("... sorted by size") mean the request asks for more than the rule does.
+double coverage(const Query& query, const IntentRule& rule, const std::string& command) {
+    if (query.tokens.empty()) {
+        return 0.0;
+    }
+    std::vector<std::string> vocabulary = splitWords(rule.vocabulary);
+    std::vector<std::string> command_words = splitWords(command);
+    size_t explained = 0;
+    for (const auto& token : query.tokens) {
+        std::string base = singular(token);
+        auto known = [&](const std::vector<std::string>& words) {
+            return std::find(words.begin(), words.end(), token) != words.end() ||
+                   std::find(words.begin(), words.end(), base) != words.end();
+        };
+        bool in_command = token.size() > 1 && (command.find(token) != std::string::npos ||
+                                               command.find(base) != std::string::npos);
+        if (FILLER_WORDS.count(token) || known(vocabulary) || known(command_words) || in_command) {
+            ++explained;
+        }
+    }
+    return static_cast<double>(explained) / static_cast<double>(query.tokens.size());
+}
+
+} // namespace
+
+IntentEngine::Result IntentEngine::match(const std::string& natural_language) const {
+    Query query(natural_language);
+    query.text = natural_language;
+    std::transform(query.text.begin(), query.text.end(), query.text.begin(), ::tolower);
+    query.tokens = splitWords(query.text);
+
+    Result best;
+    for (const auto& rule : INTENT_RULES) {
+        std::string command = rule.build(query);
+        if (command.empty()) {
+            continue;
+        }
+        double confidence = rule.confidence * coverage(query, rule, command);
+        if (confidence > best.confidence) {
+            best.intent = rule.name;
+            best.command = command;
+            best.confidence = confidence;
+        }
+    }
+    return best;
+}
+
+} // namespace ganpi
@@ -0,0 +1,354 @@
+#include "ganpi.h"
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+namespace ganpi {
+
+namespace {
+
+const size_t MAX_HISTORY = 200;
+
+#ifndef _WIN32
+
+// Puts the terminal in raw mode for its lifetime
+class RawTerminal {
+public:
+    RawTerminal() {
+        if (tcgetattr(STDIN_FILENO, &saved_) != 0) {
+            return;
+        }
+        termios raw = saved_;
+        // No line buffering, echo or signal keys; Ctrl-C is handled as an editing key
+        raw.c_lflag &= ~(ICANON | ECHO | ISIG | IEXTEN);
+        raw.c_iflag &= ~(IXON | ICRNL);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        // TCSADRAIN keeps keys typed or pasted ahead for the next line
+        active_ = tcsetattr(STDIN_FILENO, TCSADRAIN, &raw) == 0;
+    }
+    ~RawTerminal() {
+        if (active_) {
+            tcsetattr(STDIN_FILENO, TCSADRAIN, &saved_);
+        }
+    }
+    bool active() const { return active_; }
+
+private:
+    termios saved_{};
+    bool active_ = false;
+};
+
+bool isContinuationByte(char c) {
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+// Terminal columns taken by text, counting each UTF-8 character as one
+size_t columns(const std::string& text, size_t from, size_t to) {
+    size_t count = 0;
+    for (size_t i = from; i < to; ++i) {
+        if (!isContinuationByte(text[i])) ++count;
+    }
+    return count;
+}
+
+// Bytes in the key at the front of input: 1 for a plain byte, the whole
+// sequence for ESC [ ... final or ESC O x, 2 for ESC and any other byte.
+// 0 while an escape sequence is still incomplete.
+size_t keyLength(const std::string& input) {
+    if (input[0] != 27) {
+        return 1;
+    }
+    if (input.size() < 2) {
+        return 0;
+    }
+    if (input[1] == 'O') {
+        return input.size() < 3 ? 0 : 3;
+    }
+    if (input[1] != '[') {
+        return 2;
+    }
+    // Parameter and intermediate bytes up to a final byte in @..~
+    for (size_t i = 2; i < input.size(); ++i) {
+        if (input[i] >= 0x40 && input[i] <= 0x7E) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+#endif
+
+} // namespace
+
+LineEditor::LineEditor() {
+#ifndef _WIN32
+    if (pipe(wake_fds_) != 0) {
+        wake_fds_[0] = wake_fds_[1] = -1;
+        return;
+    }
+    for (int fd : wake_fds_) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+    }
+#endif
+}
+
+LineEditor::~LineEditor() {
+#ifndef _WIN32
+    for (int fd : wake_fds_) {
+        if (fd >= 0) close(fd);
+    }
+#endif
+}
+
+void LineEditor::showMessage(const std::string& message) {
+    std::lock_guard<std::mutex> lock(messages_mutex_);
+#ifndef _WIN32
+    if (editing_ && wake_fds_[1] >= 0) {
+        messages_.push_back(message);
+        // A full pipe already has a wake-up pending
+        char wake = 1;
+        ssize_t ignored = write(wake_fds_[1], &wake, 1);
+        (void)ignored;
+        return;
+    }
+#endif
+    std::cerr << message << std::endl;
+}
+
+void LineEditor::onFirstKey(Callback callback) {
+    on_first_key_ = std::move(callback);
+}
+
+void LineEditor::onPause(std::chrono::milliseconds pause, Callback callback) {
+    pause_ = pause;
+    on_pause_ = std::move(callback);
+}
+
+bool LineEditor::readLine(const std::string& prompt, std::string& line) {
+    line.clear();
+#ifndef _WIN32
+    if (isatty(STDIN_FILENO)) {
+        bool ok = readRaw(prompt, line);
+        if (ok && !line.empty() && (history_.empty() || history_.back() != line)) {
+            history_.push_back(line);
+            if (history_.size() > MAX_HISTORY) {
+                history_.erase(history_.begin());
+            }
+        }
+        return ok;
+    }
+#endif
+    std::cout << prompt << std::flush;
+    return static_cast<bool>(std::getline(std::cin, line));
+}
+
+#ifndef _WIN32
+
+bool LineEditor::readRaw(const std::string& prompt, std::string& line) {
+    // Only the prompt's last line is redrawn on each keystroke
+    size_t newline = prompt.rfind('\n');
+    std::string prompt_line = newline == std::string::npos ? prompt : prompt.substr(newline + 1);
+    std::cout << prompt << std::flush;
+
+    RawTerminal terminal;
+    if (!terminal.active()) {
+        return static_cast<bool>(std::getline(std::cin, line));
+    }
+
+    // Messages from other threads are drawn by this loop until it returns
+    struct Editing {
+        LineEditor& editor;
+        explicit Editing(LineEditor& owner) : editor(owner) {
+            std::lock_guard<std::mutex> lock(editor.messages_mutex_);
+            editor.editing_ = true;
+        }
+        ~Editing() {
+            std::lock_guard<std::mutex> lock(editor.messages_mutex_);
+            editor.editing_ = false;
+            for (const auto& message : editor.messages_) {
+                std::cerr << message << std::endl;
+            }
+            editor.messages_.clear();
+        }
+    } editing(*this);
+
+    size_t cursor = 0;
+    size_t history_index = history_.size();
+    std::string draft;              // the unfinished line while browsing history
+    std::string reported;           // last text passed to the pause callback
+    bool typed = false;
+
+    auto redraw = [&]() {
+        std::cout << "\r" << prompt_line << line << "\x1b[K";
+        size_t back = columns(line, cursor, line.size());
+        if (back > 0) {
+            std::cout << "\x1b[" << back << "D";
+        }
+        std::cout << std::flush;
+    };
+
+    char buffer[64];
+    while (true) {
+        size_t used = input_.empty() ? 0 : keyLength(input_);
+        if (used == 0) {
+            // Wait for a key, the rest of an escape sequence, a message, or the
+            // typing pause when there is news to report. A lone ESC gets a
+            // moment for its sequence to follow; a started one is held until
+            // it completes.
+            bool partial = !input_.empty();
+            bool waiting_for_pause = !partial && on_pause_ && !line.empty() && line != reported;
+            int timeout = -1;
+            if (partial && input_.size() == 1) {
+                timeout = 50;
+            } else if (waiting_for_pause) {
+                timeout = static_cast<int>(pause_.count());
+            }
+            pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {wake_fds_[0], POLLIN, 0}};
+            int ready = poll(fds, wake_fds_[0] >= 0 ? 2 : 1, timeout);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            if (ready == 0) {
+                if (partial) {
+                    input_.clear();                 // the Escape key on its own
+                } else {
+                    reported = line;
+                    on_pause_(line);
+                }
+                continue;
+            }
+            if (fds[1].revents & POLLIN) {
+                while (read(wake_fds_[0], buffer, sizeof(buffer)) > 0) {
+                }
+                std::vector<std::string> messages;
+                {
+                    std::lock_guard<std::mutex> lock(messages_mutex_);
+                    messages.swap(messages_);
+                }
+                for (const auto& message : messages) {
+                    std::cout << "\r\x1b[K" << message << "\n";
+                }
+                redraw();
+            }
+            if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+                ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+                if (n <= 0) {
+                    return false;
+                }
+                input_.append(buffer, static_cast<size_t>(n));
+            }
+            continue;
+        }
+
+        // Consume one key (a byte, or a whole escape sequence); bytes after
+        // the end of the line stay in input_ for the next call
+        char c = input_[0];
+        if (c == '\r' || c == '\n') {
+            // Terminals send CR for Enter; a pasted CRLF is one line end
+            input_.erase(0, c == '\r' && input_.size() > 1 && input_[1] == '\n' ? 2 : 1);
+            std::cout << "\r\n" << std::flush;
+            return true;
+        } else if (c == 4) {                        // Ctrl-D: end of input on an empty line
+            if (line.empty()) {
+                input_.erase(0, 1);
+                std::cout << "\r\n" << std::flush;
+                return false;
+            }
+        } else if (c == 3) {                        // Ctrl-C: abandon the line
+            line.clear();
+            cursor = 0;
+            std::cout << "^C\r\n" << prompt_line << std::flush;
+            reported.clear();
+        } else if (c == 127 || c == 8) {            // Backspace
+            if (cursor > 0) {
+                size_t start = cursor - 1;
+                while (start > 0 && isContinuationByte(line[start])) --start;
+                line.erase(start, cursor - start);
+                cursor = start;
+            }
+        } else if (c == 1) {                        // Ctrl-A
+            cursor = 0;
+        } else if (c == 5) {                        // Ctrl-E
+            cursor = line.size();
+        } else if (c == 11) {                       // Ctrl-K: kill to end
+            line.erase(cursor);
+        } else if (c == 21) {                       // Ctrl-U: kill to start
+            line.erase(0, cursor);
+            cursor = 0;
+        } else if (c == 23) {                       // Ctrl-W: delete the previous word
+            size_t start = cursor;
+            while (start > 0 && line[start - 1] == ' ') --start;
+            while (start > 0 && line[start - 1] != ' ') --start;
+            line.erase(start, cursor - start);
+            cursor = start;
+        } else if (c == 27 && used >= 3) {          // CSI or SS3 sequence
+            char key = input_[2];
+            if (key >= '0' && key <= '9') {
+                // Extended key such as ESC [ 3 ~
+                if (key == '3' && input_[used - 1] == '~' && cursor < line.size()) {
+                    size_t end = cursor + 1;
+                    while (end < line.size() && isContinuationByte(line[end])) ++end;
+                    line.erase(cursor, end - cursor);
+                }
+            } else if (key == 'C' && cursor < line.size()) {
+                ++cursor;
+                while (cursor < line.size() && isContinuationByte(line[cursor])) ++cursor;
+            } else if (key == 'D' && cursor > 0) {
+                --cursor;
+                while (cursor > 0 && isContinuationByte(line[cursor])) --cursor;
+            } else if (key == 'H') {
+                cursor = 0;
+            } else if (key == 'F') {
+                cursor = line.size();
+            } else if ((key == 'A' && history_index > 0) ||
+                       (key == 'B' && history_index < history_.size())) {
+                if (history_index == history_.size()) draft = line;
+                if (key == 'A') {
+                    --history_index;
+                } else {
+                    ++history_index;
+                }
+                line = history_index == history_.size() ? draft : history_[history_index];
+                cursor = line.size();
+            }
+        } else if (static_cast<unsigned char>(c) >= 32) {
+            line.insert(cursor, 1, c);
+            ++cursor;
+        }
+
+        input_.erase(0, used);
+        // Skip the redraw while the rest of a pasted chunk is still waiting
+        if (input_.empty()) {
+            redraw();
+        }
+
+        if (!typed && !line.empty()) {
+            typed = true;
+            if (on_first_key_) on_first_key_(line);
+        }
+    }
+}
+
+#else
+
+bool LineEditor::readRaw(const std::string& prompt, std::string& line) {
+    std::cout << prompt << std::flush;
+    return static_cast<bool>(std::getline(std::cin, line));
+}
+
+#endif
+
+} // namespace ganpi
@@ -0,0 +1,74 @@
+#include "ganpi.h"
+#include <iostream>
+#include <streambuf>
+
+namespace ganpi {
+
+namespace {
+
+// Swallows everything written to it
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return traits_type::not_eof(c); }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+std::ostream& nullStream() {
+    static NullBuffer buffer;
+    static std::ostream stream(&buffer);
+    return stream;
+}
+
+} // namespace
+
+LogLevel Log::level_ = LogLevel::Normal;
+std::ostream* Log::stream_ = nullptr;
+
+void Log::setLevel(LogLevel level) {
+    level_ = level;
+}
+
+LogLevel Log::level() {
+    return level_;
+}
+
+bool Log::enabled(LogLevel level) {
+    return static_cast<int>(level_) >= static_cast<int>(level);
+}
+
+std::ostream& Log::at(LogLevel level) {
+    if (!enabled(level)) {
+        return nullStream();
+    }
+    return stream_ ? *stream_ : std::cout;
+}
+
+void Log::setStream(std::ostream* stream) {
+    stream_ = stream;
+}
+
+bool Log::parseLevel(const std::string& name, LogLevel& level) {
+    if (name == "quiet") {
+        level = LogLevel::Quiet;
+    } else if (name == "normal") {
+        level = LogLevel::Normal;
+    } else if (name == "verbose") {
+        level = LogLevel::Verbose;
+    } else if (name == "trace") {
+        level = LogLevel::Trace;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* Log::levelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Quiet: return "quiet";
+    case LogLevel::Verbose: return "verbose";
+    case LogLevel::Trace: return "trace";
+    default: return "normal";
+    }
+}
+
+} // namespace ganpi
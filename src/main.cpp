@@ -1,6 +1,7 @@
 #include "ganpi.h"
 #include <iostream>
 #include <string>
+#include <vector>
 
 using namespace ganpi;
 
@@ -18,49 +19,117 @@ void printBanner() {
 }
 
 int main(int argc, char* argv[]) {
-    printBanner();
+    // Leading output options; everything after them is the request or mode
+    std::vector<std::string> args;
+    bool json = false;
+    bool timings = false;
+    bool use_daemon = true;
+    bool cache_lookups = true;
+    bool level_set = false;
+    LogLevel level = LogLevel::Normal;
+    int first = 1;
+    for (; first < argc; ++first) {
+        std::string arg = argv[first];
+        if (arg == "--quiet" || arg == "-q") {
+            level = LogLevel::Quiet;
+        } else if (arg == "--verbose" || arg == "-v") {
+            level = LogLevel::Verbose;
+        } else if (arg == "--trace") {
+            level = LogLevel::Trace;
+        } else if (arg == "--json") {
+            json = true;
+            continue;
+        } else if (arg == "--timings") {
+            timings = true;
+            continue;
+        } else if (arg == "--no-daemon") {
+            use_daemon = false;
+            continue;
+        } else if (arg == "--no-cache") {
+            cache_lookups = false;
+            continue;
+        } else {
+            break;
+        }
+        level_set = true;
+    }
+    for (int i = first; i < argc; ++i) {
+        args.push_back(argv[i]);
+    }
+    
+    // Started as ganpid (e.g. through a symlink): run the daemon
+    std::string program = argv[0];
+    if (program.substr(program.find_last_of('/') + 1) == "ganpid") {
+        args.insert(args.begin(), "--daemon");
+    }
+    
+    // In JSON mode stdout carries only the results; prompts and messages move to stderr
+    std::streambuf* stdout_buffer = std::cout.rdbuf();
+    std::ostream json_out(stdout_buffer);
+    if (json) {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+    
+    if (!json && (!level_set || level != LogLevel::Quiet)) {
+        printBanner();
+    }
     
+    int status = 0;
     try {
         GANPI app;
-        
-        if (!app.initialize()) {
-            std::cerr << "❌ Failed to initialize GANPI. Please check your configuration." << std::endl;
-            return 1;
+        if (level_set) {
+            app.setLogLevel(level);
+        }
+        if (json) {
+            app.setJsonOutput(&json_out);
         }
+        app.setShowTimings(timings);
+        app.setCacheLookups(cache_lookups);
         
-        // Handle command line arguments
-        if (argc > 1) {
-            std::string command;
-            
-            // Check for help flag
-            if (std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h") {
-                app.showHelp();
-                return 0;
-            }
-            
-            // Check for interactive mode
-            if (std::string(argv[1]) == "--interactive" || std::string(argv[1]) == "-i") {
-                app.runInteractive();
-                return 0;
+        // A one-shot request goes to ganpid when one is running, skipping
+        // the config, key and connection setup
+        std::string socket_path = GANPI::defaultSocketPath();
+        bool one_shot = !args.empty() && args[0].compare(0, 1, "-") != 0;
+        bool attached = one_shot && use_daemon && app.attachDaemon(socket_path);
+        
+        if (!args.empty() && args[0] == "--stop-daemon") {
+            status = GANPI::stopDaemon(socket_path) ? 0 : 1;
+        } else if (!attached && !app.initialize()) {
+            std::cerr << "❌ Failed to initialize GANPI. Please check your configuration." << std::endl;
+            status = 1;
+        } else if (args.empty()) {
+            // No arguments provided, show help
+            app.showHelp();
+            std::cout << "\n💡 Try: ganpi \"Find all PDF files in Downloads and zip them\"" << std::endl;
+        } else if (args[0] == "--help" || args[0] == "-h") {
+            app.showHelp();
+        } else if (args[0] == "--interactive" || args[0] == "-i") {
+            app.runInteractive();
+        } else if (args[0] == "--daemon") {
+            status = app.runDaemon(socket_path);
+        } else if (args[0] == "--batch" || args[0] == "-b") {
+            if (args.size() < 2) {
+                std::cerr << "❌ --batch needs a file of requests" << std::endl;
+                status = 1;
+            } else {
+                bool auto_confirm = (args.size() > 2 && (args[2] == "--yes" || args[2] == "-y"));
+                app.runBatch(args[1], auto_confirm);
             }
-            
+        } else {
             // Concatenate all arguments as the natural language command
-            for (int i = 1; i < argc; ++i) {
-                if (i > 1) command += " ";
-                command += argv[i];
+            std::string command;
+            for (size_t i = 0; i < args.size(); ++i) {
+                if (i > 0) command += " ";
+                command += args[i];
             }
-            
             app.processCommand(command);
-        } else {
-            // No arguments provided, show help
-            app.showHelp();
-            std::cout << "\n💡 Try: ganpi \"Find all PDF files in Downloads and zip them\"" << std::endl;
         }
         
     } catch (const std::exception& e) {
         std::cerr << "❌ Error: " << e.what() << std::endl;
-        return 1;
+        status = 1;
     }
     
-    return 0;
+    std::cout.rdbuf(stdout_buffer);
+    return status;
 }
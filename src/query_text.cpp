@@ -0,0 +1,166 @@
+#include "ganpi.h"
+#include <algorithm>
+#include <cctype>
+
+namespace ganpi {
+
+namespace {
+
+bool isWordChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool isDirectoryWord(const std::string& word) {
+    return word == "directory" || word == "dir" || word == "folder";
+}
+
+// Directory names people tend to mention by name, with or without a plural s
+bool isKnownDirectory(const std::string& word, bool include_home) {
+    static const char* const names[] = {
+        "test", "dir1", "dir2", "download", "downloads", "document", "documents",
+        "backup", "temp", "home", "desktop"
+    };
+    for (const char* name : names) {
+        if (word == name) {
+            return include_home || (word != "home" && word != "desktop");
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+QueryText::QueryText(const std::string& text) {
+    std::string term;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        if (i < text.size() && !std::isspace(static_cast<unsigned char>(text[i]))) {
+            term += static_cast<char>(std::tolower(static_cast<unsigned char>(text[i])));
+            continue;
+        }
+        // Strip quotes and sentence punctuation, and a trailing slash
+        size_t start = term.find_first_not_of("\"'`([{<");
+        size_t end = term.find_last_not_of("\"'`)]}>,;:!?.");
+        if (start != std::string::npos && end != std::string::npos && end >= start) {
+            term = term.substr(start, end - start + 1);
+            while (term.size() > 1 && term.back() == '/') term.pop_back();
+            terms_.push_back(term);
+        }
+        term.clear();
+    }
+
+    bool only_space = false;
+    for (size_t i = 0; i < text.size(); ) {
+        if (!isWordChar(text[i])) {
+            only_space = only_space && std::isspace(static_cast<unsigned char>(text[i]));
+            ++i;
+            continue;
+        }
+        Word word;
+        word.spaced = only_space;
+        for (; i < text.size() && isWordChar(text[i]); ++i) {
+            word.text += static_cast<char>(std::tolower(static_cast<unsigned char>(text[i])));
+        }
+        words_.push_back(std::move(word));
+        only_space = true;
+    }
+}
+
+std::vector<std::string> QueryText::words() const {
+    std::vector<std::string> words;
+    words.reserve(words_.size());
+    for (const auto& word : words_) {
+        words.push_back(word.text);
+    }
+    return words;
+}
+
+std::vector<std::string> QueryText::mentionedDirectories(bool include_home) const {
+    std::vector<std::string> dirs;
+    for (const auto& word : words_) {
+        if (isKnownDirectory(word.text, include_home)) {
+            dirs.push_back(word.text);
+        }
+    }
+    return dirs;
+}
+
+std::string QueryText::directoryAfter(std::initializer_list<const char*> keywords) const {
+    for (size_t i = 0; i < words_.size(); ++i) {
+        bool keyword = std::any_of(keywords.begin(), keywords.end(),
+                                   [&](const char* k) { return words_[i].text == k; });
+        if (!keyword) {
+            continue;
+        }
+        // With "the" skipped first, then as the name itself, the way the regex backtracked
+        if (follows(i + 1) && words_[i + 1].text == "the" && follows(i + 2) && follows(i + 3) &&
+            isDirectoryWord(words_[i + 3].text)) {
+            return words_[i + 2].text;
+        }
+        if (follows(i + 1) && follows(i + 2) && isDirectoryWord(words_[i + 2].text)) {
+            return words_[i + 1].text;
+        }
+    }
+    return "";
+}
+
+std::string QueryText::nestedPath(const std::string& dir_name) const {
+    for (size_t i = 0; i < words_.size(); ++i) {
+        if (words_[i].text != dir_name) {
+            continue;
+        }
+        size_t j = i + 1;
+        if (follows(j) && isDirectoryWord(words_[j].text)) ++j;
+        if (!follows(j) || words_[j].text != "in") continue;
+        ++j;
+        if (follows(j) && words_[j].text == "the" && follows(j + 1)) ++j;
+        if (follows(j)) {
+            // Found "dir1 in test" -> return "test/dir1" (Unix-style path)
+            return words_[j].text + "/" + dir_name;
+        }
+    }
+    return dir_name;
+}
+
+void DirectoryIndex::add(const std::string& relative_path) {
+    size_t slash = relative_path.find_last_of('/');
+    std::string name = slash == std::string::npos ? relative_path : relative_path.substr(slash + 1);
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    if (!name.empty()) {
+        by_name_[name].push_back(relative_path);
+    }
+    // A nested path can also be named in full ("src/util")
+    if (slash != std::string::npos) {
+        std::string path = relative_path;
+        std::transform(path.begin(), path.end(), path.begin(), ::tolower);
+        by_name_[path].push_back(relative_path);
+    }
+}
+
+bool DirectoryIndex::contains(const std::string& name) const {
+    return by_name_.count(name) > 0;
+}
+
+std::vector<std::string> DirectoryIndex::match(const QueryText& query, size_t max_results) const {
+    std::vector<std::string> paths;
+    auto add_matches = [&](const std::string& candidate) {
+        auto it = by_name_.find(candidate);
+        if (it == by_name_.end()) {
+            return;
+        }
+        for (const auto& path : it->second) {
+            if (paths.size() < max_results && std::find(paths.begin(), paths.end(), path) == paths.end()) {
+                paths.push_back(path);
+            }
+        }
+    };
+    // Whole terms first ("my-app"), then their \w pieces ("app")
+    for (const auto& term : query.terms()) {
+        add_matches(term);
+    }
+    for (const auto& word : query.words()) {
+        add_matches(word);
+    }
+    return paths;
+}
+
+} // namespace ganpi
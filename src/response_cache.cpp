@@ -0,0 +1,254 @@
+#include "ganpi.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ganpi {
+
+namespace {
+
+const uint64_t CACHE_MAGIC = 0x3148434143504e47ULL; // "GNPCACH1"
+const uint32_t CACHE_VERSION = 1;
+const size_t CACHE_WAYS = 8;           // Slots per bucket; LRU applies within a bucket
+const size_t MAX_COMMAND_LENGTH = 1000;
+
+struct CacheHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t buckets;
+    uint64_t clock;     // Monotonic LRU tick shared by every process using the file
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t reserved[3];
+};
+
+struct CacheSlot {
+    uint64_t key;       // 0 = empty
+    int64_t created;
+    uint64_t last_used;
+    uint32_t length;
+    char command[MAX_COMMAND_LENGTH + 4];
+};
+
+// Exclusive flock for the lifetime of the scope, so a team can share one file
+class FileLock {
+public:
+    explicit FileLock(int fd) : fd_(fd) { flock(fd_, LOCK_EX); }
+    ~FileLock() { flock(fd_, LOCK_UN); }
+private:
+    int fd_;
+};
+
+uint64_t fnv1a(uint64_t hash, const std::string& data) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    // Separator so ("ab","c") and ("a","bc") hash differently
+    hash ^= 0xff;
+    hash *= 0x100000001b3ULL;
+    return hash;
+}
+
+// Lowercase, trim, collapse whitespace and drop trailing punctuation
+std::string normalizeQuery(const std::string& query) {
+    std::string normalized;
+    normalized.reserve(query.size());
+    bool space = false;
+    for (unsigned char c : query) {
+        if (std::isspace(c)) {
+            space = !normalized.empty();
+            continue;
+        }
+        if (space) {
+            normalized += ' ';
+            space = false;
+        }
+        normalized += static_cast<char>(std::tolower(c));
+    }
+    while (!normalized.empty() && std::strchr(".!?", normalized.back())) {
+        normalized.pop_back();
+    }
+    return normalized;
+}
+
+size_t mappedSize(uint32_t buckets) {
+    return sizeof(CacheHeader) + static_cast<size_t>(buckets) * CACHE_WAYS * sizeof(CacheSlot);
+}
+
+} // namespace
+
+ResponseCache::ResponseCache(const std::string& path, long ttl_seconds, size_t max_entries)
+    : path_(path), ttl_seconds_(ttl_seconds) {
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0664);
+    if (fd_ < 0) {
+        std::cerr << "Warning: Could not open response cache " << path << std::endl;
+        return;
+    }
+
+    FileLock lock(fd_);
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        return;
+    }
+
+    uint32_t buckets = static_cast<uint32_t>(std::max<size_t>(1, max_entries / CACHE_WAYS));
+    bool fresh = (st.st_size == 0);
+    if (fresh) {
+        if (ftruncate(fd_, static_cast<off_t>(mappedSize(buckets))) != 0) {
+            std::cerr << "Warning: Could not size response cache " << path << std::endl;
+            return;
+        }
+    } else {
+        // An existing file keeps its own geometry, whoever created it
+        CacheHeader existing;
+        if (pread(fd_, &existing, sizeof(existing), 0) != static_cast<ssize_t>(sizeof(existing)) ||
+            existing.magic != CACHE_MAGIC || existing.version != CACHE_VERSION ||
+            static_cast<size_t>(st.st_size) < mappedSize(existing.buckets)) {
+            std::cerr << "Warning: Ignoring incompatible response cache " << path << std::endl;
+            return;
+        }
+        buckets = existing.buckets;
+    }
+
+    size_ = mappedSize(buckets);
+    void* mapping = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        size_ = 0;
+        return;
+    }
+    mapping_ = mapping;
+
+    if (fresh) {
+        auto* header = static_cast<CacheHeader*>(mapping_);
+        std::memset(header, 0, sizeof(CacheHeader));
+        header->magic = CACHE_MAGIC;
+        header->version = CACHE_VERSION;
+        header->buckets = buckets;
+    }
+}
+
+ResponseCache::~ResponseCache() {
+    if (mapping_) {
+        munmap(mapping_, size_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool ResponseCache::isOpen() const {
+    return mapping_ != nullptr;
+}
+
+uint64_t ResponseCache::makeKey(const std::string& model, const std::string& query,
+                                const std::string& context) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = fnv1a(hash, model);
+    hash = fnv1a(hash, normalizeQuery(query));
+    hash = fnv1a(hash, context);
+    return hash == 0 ? 1 : hash;
+}
+
+bool ResponseCache::lookup(uint64_t key, std::string& command) {
+    if (!mapping_) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    FileLock lock(fd_);
+    auto* header = static_cast<CacheHeader*>(mapping_);
+    auto* slots = reinterpret_cast<CacheSlot*>(header + 1);
+    CacheSlot* bucket = slots + (key % header->buckets) * CACHE_WAYS;
+    int64_t now = static_cast<int64_t>(time(nullptr));
+
+    for (size_t i = 0; i < CACHE_WAYS; ++i) {
+        CacheSlot& slot = bucket[i];
+        if (slot.key != key) {
+            continue;
+        }
+        if (ttl_seconds_ > 0 && now - slot.created > ttl_seconds_) {
+            slot.key = 0; // Expired
+            break;
+        }
+        slot.last_used = ++header->clock;
+        ++header->hits;
+        command.assign(slot.command, std::min<size_t>(slot.length, MAX_COMMAND_LENGTH));
+        return true;
+    }
+
+    ++header->misses;
+    return false;
+}
+
+void ResponseCache::store(uint64_t key, const std::string& command) {
+    if (!mapping_ || command.empty() || command.size() > MAX_COMMAND_LENGTH) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    FileLock lock(fd_);
+    auto* header = static_cast<CacheHeader*>(mapping_);
+    auto* slots = reinterpret_cast<CacheSlot*>(header + 1);
+    CacheSlot* bucket = slots + (key % header->buckets) * CACHE_WAYS;
+    int64_t now = static_cast<int64_t>(time(nullptr));
+
+    // Reuse the same key, else an empty or expired slot, else evict the least recently used
+    CacheSlot* victim = nullptr;
+    for (size_t i = 0; i < CACHE_WAYS && !victim; ++i) {
+        if (bucket[i].key == key) victim = &bucket[i];
+    }
+    for (size_t i = 0; i < CACHE_WAYS && !victim; ++i) {
+        bool expired = ttl_seconds_ > 0 && now - bucket[i].created > ttl_seconds_;
+        if (bucket[i].key == 0 || expired) victim = &bucket[i];
+    }
+    if (!victim) {
+        victim = std::min_element(bucket, bucket + CACHE_WAYS,
+            [](const CacheSlot& a, const CacheSlot& b) { return a.last_used < b.last_used; });
+    }
+
+    victim->key = key;
+    victim->created = now;
+    victim->last_used = ++header->clock;
+    victim->length = static_cast<uint32_t>(command.size());
+    std::memcpy(victim->command, command.data(), command.size());
+}
+
+void ResponseCache::erase(uint64_t key) {
+    if (!mapping_) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    FileLock lock(fd_);
+    auto* header = static_cast<CacheHeader*>(mapping_);
+    auto* slots = reinterpret_cast<CacheSlot*>(header + 1);
+    CacheSlot* bucket = slots + (key % header->buckets) * CACHE_WAYS;
+    for (size_t i = 0; i < CACHE_WAYS; ++i) {
+        if (bucket[i].key == key) {
+            bucket[i].key = 0;
+        }
+    }
+}
+
+ResponseCache::Stats ResponseCache::stats() const {
+    Stats stats;
+    if (!mapping_) {
+        return stats;
+    }
+    const auto* header = static_cast<const CacheHeader*>(mapping_);
+    stats.hits = header->hits;
+    stats.misses = header->misses;
+    stats.capacity = static_cast<size_t>(header->buckets) * CACHE_WAYS;
+    return stats;
+}
+
+} // namespace ganpi
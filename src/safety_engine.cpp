@@ -0,0 +1,467 @@
+#include "ganpi.h"
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+
+namespace ganpi {
+
+namespace {
+
+struct DefaultRule {
+    SafetyEngine::Verdict verdict;
+    const char* pattern;
+};
+
+// Built-in rules: Block filters the command out, Warn asks before running it
+const DefaultRule DEFAULT_RULES[] = {
+#ifdef _WIN32
+    {SafetyEngine::Verdict::Block, "format"},
+    {SafetyEngine::Verdict::Block, "del /s /q C:\\"},
+    {SafetyEngine::Verdict::Block, "rmdir /s /q C:\\"},
+    {SafetyEngine::Verdict::Block, "shutdown"},
+    {SafetyEngine::Verdict::Block, "reboot"},
+    {SafetyEngine::Verdict::Warn, "del /s"},
+    {SafetyEngine::Verdict::Warn, "rmdir /s"},
+#else
+    {SafetyEngine::Verdict::Block, "rm -rf /"},
+    {SafetyEngine::Verdict::Block, "sudo rm -rf"},
+    {SafetyEngine::Verdict::Block, "format"},
+    {SafetyEngine::Verdict::Block, "mkfs"},
+    {SafetyEngine::Verdict::Block, ":(){ :|:& };:"},  // Fork bomb
+    {SafetyEngine::Verdict::Block, "dd if=/dev/urandom"},
+    {SafetyEngine::Verdict::Block, "shutdown"},
+    {SafetyEngine::Verdict::Block, "reboot"},
+    {SafetyEngine::Verdict::Block, "halt"},
+    {SafetyEngine::Verdict::Block, "poweroff"},
+    {SafetyEngine::Verdict::Warn, "rm -rf"},
+    {SafetyEngine::Verdict::Warn, "sudo"},
+    {SafetyEngine::Verdict::Warn, "dd"},
+    {SafetyEngine::Verdict::Warn, "chmod 777"},
+    {SafetyEngine::Verdict::Warn, "chown root"},
+    {SafetyEngine::Verdict::Warn, "passwd"},
+#endif
+};
+
+unsigned char lower(unsigned char c) {
+    return static_cast<unsigned char>(std::tolower(c));
+}
+
+const int MAX_WALK_DEPTH = 16;
+
+// Characters that continue a word for rule matching, so "dd" does not match
+// inside "git add" nor "format" inside "clang-format"
+bool isWordChar(unsigned char c) {
+    return std::isalnum(c) || c == '_' || c == '-' || c == '.';
+}
+
+std::string_view baseName(std::string_view word) {
+    size_t slash = word.find_last_of('/');
+    return slash == std::string_view::npos || slash + 1 == word.size() ? word : word.substr(slash + 1);
+}
+
+bool isShell(std::string_view name) {
+    return name == "sh" || name == "bash" || name == "dash" || name == "zsh" ||
+           name == "ksh" || name == "ash";
+}
+
+// Whole disks and partitions; writing to them destroys file systems
+bool isBlockDevice(std::string_view path) {
+    static const char* const prefixes[] = {
+        "/dev/sd", "/dev/hd", "/dev/vd", "/dev/xvd", "/dev/nvme", "/dev/mmcblk", "/dev/disk", "/dev/md"
+    };
+    for (const char* prefix : prefixes) {
+        if (path.compare(0, std::strlen(prefix), prefix) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A path without a trailing "/*" or "/." and trailing slashes, so "/usr/*",
+// "/usr/." and "/usr/" all name /usr. True when anything was stripped.
+bool stripDirectorySuffix(std::string_view& target) {
+    size_t size = target.size();
+    if (size >= 2 && target[size - 2] == '/' && (target.back() == '*' || target.back() == '.')) {
+        target.remove_suffix(1);
+    }
+    while (!target.empty() && target.back() == '/') {
+        target.remove_suffix(1);
+    }
+    return target.size() != size;
+}
+
+// "/", "/*", "/.", "~", "~/", "$HOME/*" and the like: an rm -r here wipes
+// everything. A bare "*" is only the current directory's contents.
+bool isRootTarget(std::string_view target) {
+    bool stripped = stripDirectorySuffix(target);
+    return (target.empty() && stripped) || target == "~" || target == "$HOME" || target == "${HOME}";
+}
+
+// "/usr", "/etc/", "/home/*" and any other directory directly under /
+bool isTopLevelDirectory(std::string_view target) {
+    stripDirectorySuffix(target);
+    return target.size() > 1 && target[0] == '/' && target.find('/', 1) == std::string_view::npos &&
+           target != "/." && target != "/..";
+}
+
+std::string trim(const std::string& s) {
+    size_t start = s.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) {
+        return "";
+    }
+    return s.substr(start, s.find_last_not_of(" \t\r\n") - start + 1);
+}
+
+} // namespace
+
+SafetyEngine::SafetyEngine() {
+    for (const auto& rule : DEFAULT_RULES) {
+        addRule(rule.verdict, rule.pattern);
+    }
+    compile();
+}
+
+void SafetyEngine::addRule(Verdict verdict, const std::string& pattern) {
+    // Whitespace runs become single spaces, the separator classify() uses between words
+    std::string canonical;
+    for (char c : trim(pattern)) {
+        bool blank = (c == ' ' || c == '\t');
+        if (!blank) {
+            canonical += c;
+        } else if (canonical.back() != ' ') {
+            canonical += ' ';
+        }
+    }
+    if (!canonical.empty() && verdict != Verdict::Safe) {
+        rules_.push_back({verdict, canonical});
+    }
+}
+
+bool SafetyEngine::loadRules(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        // A line without a recognised keyword is treated as a warning pattern
+        size_t space = line.find_first_of(" \t");
+        std::string keyword = line.substr(0, space);
+        if (space != std::string::npos && keyword == "block") {
+            addRule(Verdict::Block, trim(line.substr(space)));
+        } else if (space != std::string::npos && keyword == "warn") {
+            addRule(Verdict::Warn, trim(line.substr(space)));
+        } else {
+            addRule(Verdict::Warn, line);
+        }
+    }
+    compile();
+    return true;
+}
+
+void SafetyEngine::compile() {
+    // Only bytes that occur in some pattern get their own column in the table
+    std::memset(classes_, 0, sizeof(classes_));
+    alphabet_ = 1;
+    for (const auto& rule : rules_) {
+        for (unsigned char c : rule.pattern) {
+            unsigned char l = lower(c);
+            if (!classes_[l]) {
+                classes_[l] = static_cast<uint8_t>(alphabet_++);
+            }
+        }
+    }
+    // Upper-case input maps to the same class as its lower-case form
+    for (int c = 0; c < 256; ++c) {
+        classes_[c] = classes_[lower(static_cast<unsigned char>(c))];
+    }
+
+    // Trie of all patterns
+    transitions_.assign(alphabet_, -1);
+    own_.assign(1, -1);
+    depth_.assign(1, 0);
+    for (size_t r = 0; r < rules_.size(); ++r) {
+        int32_t state = 0;
+        for (unsigned char c : rules_[r].pattern) {
+            int32_t& next = transitions_[state * alphabet_ + classes_[c]];
+            if (next < 0) {
+                next = static_cast<int32_t>(own_.size());
+                own_.push_back(-1);
+                depth_.push_back(depth_[state] + 1);
+                transitions_.resize(transitions_.size() + alphabet_, -1);
+            }
+            // Re-index: resize may have moved the table under the reference
+            state = transitions_[state * alphabet_ + classes_[c]];
+        }
+        int32_t& own = own_[state];
+        if (own < 0 || rules_[r].verdict > rules_[own].verdict) {
+            own = static_cast<int32_t>(r);
+        }
+    }
+    outputs_ = own_;
+    dictionary_.assign(own_.size(), -1);
+
+    // Breadth-first failure links, folded into a full DFA so scanning never backtracks
+    std::vector<int32_t> fail(own_.size(), 0);
+    std::vector<int32_t> queue;
+    queue.reserve(own_.size());
+    for (size_t c = 0; c < alphabet_; ++c) {
+        int32_t& next = transitions_[c];
+        if (next < 0) {
+            next = 0;
+        } else {
+            queue.push_back(next);
+        }
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+        int32_t state = queue[head];
+        dictionary_[state] = own_[fail[state]] >= 0 ? fail[state] : dictionary_[fail[state]];
+        int32_t inherited = outputs_[fail[state]];
+        int32_t& out = outputs_[state];
+        if (inherited >= 0 && (out < 0 || rules_[inherited].verdict > rules_[out].verdict)) {
+            out = inherited;
+        }
+        for (size_t c = 0; c < alphabet_; ++c) {
+            int32_t& next = transitions_[state * alphabet_ + c];
+            int32_t fallback = transitions_[fail[state] * alphabet_ + c];
+            if (next < 0) {
+                next = fallback;
+            } else {
+                fail[next] = fallback;
+                queue.push_back(next);
+            }
+        }
+    }
+}
+
+// State carried through one classify() call
+struct SafetyEngine::Walk {
+    ShellArena arena;
+    Match match;
+    std::string words;                          // canonical text of the current command
+    std::vector<std::string_view> functions;    // functions being defined, innermost last
+    int depth = 0;
+
+    void raise(Verdict verdict, const std::string& pattern) {
+        if (verdict > match.verdict) {
+            match.verdict = verdict;
+            match.pattern = pattern;
+        }
+    }
+};
+
+SafetyEngine::Match SafetyEngine::classify(const std::string& command) const {
+    Walk walk;
+    ShellScript* script = ShellParser(walk.arena).parse(command);
+    if (!script) {
+        // Not something we can read as shell, so be as strict as plain matching
+        return scan(command);
+    }
+    classifyScript(script, walk);
+    return walk.match;
+}
+
+void SafetyEngine::classifyText(std::string_view text, Walk& walk) const {
+    ShellScript* script = ShellParser(walk.arena).parse(text);
+    if (!script) {
+        Match raw = scan(std::string(text));
+        walk.raise(raw.verdict, raw.pattern);
+        return;
+    }
+    classifyScript(script, walk);
+}
+
+void SafetyEngine::classifyScript(const ShellScript* script, Walk& walk) const {
+    if (++walk.depth > MAX_WALK_DEPTH) {
+        walk.raise(Verdict::Warn, "deeply nested command");
+        --walk.depth;
+        return;
+    }
+    for (; script && walk.match.verdict != Verdict::Block; script = script->next) {
+        for (const ShellPipeline* pipeline = script->pipelines; pipeline; pipeline = pipeline->next) {
+            bool piped = pipeline->commands && pipeline->commands->next;
+            for (const ShellCommand* command = pipeline->commands; command; command = command->next) {
+                // A function that calls itself through a pipe or in the background is a fork bomb
+                if (command->kind == ShellCommand::Kind::Simple && command->words &&
+                    (piped || pipeline->separator == "&")) {
+                    std::string_view name = command->words->text;
+                    for (std::string_view function : walk.functions) {
+                        if (function == name) {
+                            walk.raise(Verdict::Block, "fork bomb");
+                        }
+                    }
+                }
+                classifyCommand(command, walk);
+            }
+        }
+    }
+    --walk.depth;
+}
+
+void SafetyEngine::classifyWords(const ShellWord* words, Walk& walk) const {
+    for (const ShellWord* word = words; word; word = word->next) {
+        if (word->substitutions) {
+            classifyScript(word->substitutions, walk);
+        }
+    }
+}
+
+void SafetyEngine::classifyCommand(const ShellCommand* command, Walk& walk) const {
+    for (const ShellRedirect* redirect = command->redirects; redirect; redirect = redirect->next) {
+        classifyWords(redirect->target, walk);
+        if (redirect->op.find('>') != std::string_view::npos && isBlockDevice(redirect->target->text)) {
+            walk.raise(Verdict::Block, "write to " + std::string(redirect->target->text));
+        }
+    }
+
+    if (command->kind != ShellCommand::Kind::Simple) {
+        if (command->kind == ShellCommand::Kind::Function) {
+            walk.functions.push_back(command->name);
+            classifyScript(command->body, walk);
+            walk.functions.pop_back();
+        } else {
+            classifyScript(command->body, walk);
+        }
+        return;
+    }
+    classifyWords(command->words, walk);
+
+    // Canonical text: words joined by single spaces, command names reduced to
+    // their base name, and blanks inside a quoted word kept distinct from separators
+    std::string& text = walk.words;
+    text.clear();
+    const ShellWord* name = ShellParser::findProgram(command->words);
+    bool command_position = true;
+    bool leading = true;
+    for (const ShellWord* word = command->words; word; word = word->next) {
+        if (leading && ShellParser::isAssignment(word->text)) {
+            continue;
+        }
+        leading = false;
+        std::string_view word_text = command_position ? baseName(word->text) : word->text;
+        if (word == name) {
+            command_position = false;
+        }
+        if (!text.empty()) {
+            text += ' ';
+        }
+        for (char c : word_text) {
+            text += (c == ' ' || c == '\t' || c == '\n') ? '\x01' : c;
+        }
+    }
+    matchWords(text, walk.match);
+    if (!name) {
+        return;
+    }
+
+    std::string_view program = baseName(name->text);
+    if (program == "rm") {
+        bool recursive = false;
+        bool force = false;
+        bool root = false;
+        std::string_view system_directory;
+        for (const ShellWord* arg = name->next; arg; arg = arg->next) {
+            std::string_view a = arg->text;
+            if (a == "--no-preserve-root") {
+                walk.raise(Verdict::Block, "rm --no-preserve-root");
+            } else if (a == "--recursive") {
+                recursive = true;
+            } else if (a == "--force") {
+                force = true;
+            } else if (a.size() > 1 && a[0] == '-' && a[1] != '-') {
+                recursive = recursive || a.find_first_of("rR") != std::string_view::npos;
+                force = force || a.find('f') != std::string_view::npos;
+            } else if (isRootTarget(a)) {
+                // Quoting stops ~ and * from expanding, leaving a harmless literal name
+                root = root || !arg->quoted || a.find_first_of("~*") == std::string_view::npos;
+            } else if (isTopLevelDirectory(a) && system_directory.empty()) {
+                system_directory = a;
+            }
+        }
+        if (recursive && root) {
+            walk.raise(Verdict::Block, "rm -r /");
+        } else if (recursive && !system_directory.empty()) {
+            walk.raise(Verdict::Block, "rm -r " + std::string(system_directory));
+        } else if (recursive && force) {
+            walk.raise(Verdict::Warn, "rm -rf");
+        }
+    } else if (program == "dd") {
+        for (const ShellWord* arg = name->next; arg; arg = arg->next) {
+            if (arg->text.compare(0, 3, "of=") == 0 && isBlockDevice(arg->text.substr(3))) {
+                walk.raise(Verdict::Block, "dd of=" + std::string(arg->text.substr(3)));
+            }
+        }
+    } else if (program.compare(0, 4, "mkfs") == 0) {
+        walk.raise(Verdict::Block, "mkfs");
+    } else if (isShell(program)) {
+        // sh -c "..." runs its argument as a script
+        for (const ShellWord* arg = name->next; arg; arg = arg->next) {
+            if (arg->text == "-c" && arg->next) {
+                classifyText(arg->next->text, walk);
+                break;
+            }
+        }
+    } else if (program == "eval") {
+        std::string script;
+        for (const ShellWord* arg = name->next; arg; arg = arg->next) {
+            script += std::string(arg->text) + " ";
+        }
+        classifyText(walk.arena.copy(script), walk);
+    }
+}
+
+// Like scan(), but a rule only counts when it starts and ends on word boundaries
+void SafetyEngine::matchWords(const std::string& text, Match& match) const {
+    int32_t best = -1;
+    int32_t state = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        state = transitions_[state * alphabet_ + classes_[static_cast<unsigned char>(text[i])]];
+        bool ends_word = (i + 1 == text.size() || !isWordChar(static_cast<unsigned char>(text[i + 1])));
+        if (!ends_word) {
+            continue;
+        }
+        for (int32_t s = own_[state] >= 0 ? state : dictionary_[state]; s >= 0; s = dictionary_[s]) {
+            size_t start = i + 1 - static_cast<size_t>(depth_[s]);
+            if (start > 0 && isWordChar(static_cast<unsigned char>(text[start - 1]))) {
+                continue;
+            }
+            int32_t rule = own_[s];
+            if (best < 0 || rules_[rule].verdict > rules_[best].verdict) {
+                best = rule;
+            }
+        }
+    }
+    if (best >= 0 && rules_[best].verdict > match.verdict) {
+        match.verdict = rules_[best].verdict;
+        match.pattern = rules_[best].pattern;
+    }
+}
+
+SafetyEngine::Match SafetyEngine::scan(const std::string& command) const {
+    Match match;
+    int32_t best = -1;
+    int32_t state = 0;
+    for (unsigned char c : command) {
+        state = transitions_[state * alphabet_ + classes_[c]];
+        int32_t out = outputs_[state];
+        if (out >= 0 && (best < 0 || rules_[out].verdict > rules_[best].verdict)) {
+            best = out;
+            if (rules_[best].verdict == Verdict::Block) {
+                break;
+            }
+        }
+    }
+    if (best >= 0) {
+        match.verdict = rules_[best].verdict;
+        match.pattern = rules_[best].pattern;
+    }
+    return match;
+}
+
+} // namespace ganpi
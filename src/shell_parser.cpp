@@ -0,0 +1,606 @@
+#include "ganpi.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace ganpi {
+
+namespace {
+
+const size_t ARENA_BLOCK_SIZE = 8192;
+const int MAX_NESTING = 32;
+
+// Characters that end an unquoted word
+bool isMeta(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == ';' || c == '&' ||
+           c == '|' || c == '(' || c == ')' || c == '<' || c == '>';
+}
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// Words that only steer control flow; the commands around them are what
+// matter. for, select and case stay as the first word of their header, so
+// the loop variable or subject is not taken for a program.
+bool isSkippedKeyword(std::string_view word) {
+    static const char* const keywords[] = {
+        "if", "then", "else", "elif", "fi", "do", "done", "while", "until", "in", "esac"
+    };
+    for (const char* keyword : keywords) {
+        if (word == keyword) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+namespace {
+
+// A prefix that runs the command after it, and the arguments it takes first
+struct Wrapper {
+    const char* name;
+    const char* short_options;          // letters whose option takes an argument
+    const char* const* long_options;    // likewise, without the leading --
+    int operands;                       // words before the command, e.g. timeout DURATION
+    bool assignments;                   // NAME=value words may come before the command
+};
+
+const char* const SUDO_LONG[] = {"user", "group", "host", "prompt", "chroot", "chdir", "role", "type",
+                                 "close-from", "other-user", "command-timeout", nullptr};
+const char* const ENV_LONG[] = {"unset", "chdir", "split-string", nullptr};
+const char* const TIME_LONG[] = {"format", "output", nullptr};
+const char* const NICE_LONG[] = {"adjustment", nullptr};
+const char* const IONICE_LONG[] = {"class", "classdata", "pid", "pgid", "uid", nullptr};
+const char* const XARGS_LONG[] = {"arg-file", "delimiter", "max-args", "max-procs", "max-chars",
+                                  "process-slot-var", nullptr};
+const char* const TIMEOUT_LONG[] = {"signal", "kill-after", nullptr};
+const char* const STDBUF_LONG[] = {"input", "output", "error", nullptr};
+const char* const STRACE_LONG[] = {"output", "attach", "expr", "string-limit", "user", nullptr};
+const char* const CHROOT_LONG[] = {"userspec", "groups", nullptr};
+const char* const NO_LONG[] = {nullptr};
+
+const Wrapper WRAPPERS[] = {
+    {"sudo", "ugCDhpRrtTU", SUDO_LONG, 0, true},
+    {"doas", "uC", NO_LONG, 0, false},
+    {"env", "uSC", ENV_LONG, 0, true},
+    {"nohup", "", NO_LONG, 0, false},
+    {"time", "fo", TIME_LONG, 0, false},
+    {"nice", "n", NICE_LONG, 0, false},
+    {"ionice", "cnpPu", IONICE_LONG, 0, false},
+    {"exec", "a", NO_LONG, 0, false},
+    {"command", "", NO_LONG, 0, false},
+    {"builtin", "", NO_LONG, 0, false},
+    {"xargs", "aEdILnPs", XARGS_LONG, 0, false},
+    {"timeout", "sk", TIMEOUT_LONG, 1, false},
+    {"stdbuf", "ioe", STDBUF_LONG, 0, false},
+    {"strace", "abeEIoOpPsSUuX", STRACE_LONG, 0, false},
+    {"chroot", "", CHROOT_LONG, 1, false},
+};
+
+const Wrapper* findWrapper(std::string_view word) {
+    size_t slash = word.find_last_of('/');
+    std::string_view name = slash == std::string_view::npos ? word : word.substr(slash + 1);
+    for (const Wrapper& wrapper : WRAPPERS) {
+        if (name == wrapper.name) {
+            return &wrapper;
+        }
+    }
+    return nullptr;
+}
+
+// Whether the option word is followed by its argument as the next word
+bool takesSeparateArgument(const Wrapper& wrapper, std::string_view option) {
+    if (option.compare(0, 2, "--") == 0) {
+        if (option.find('=') != std::string_view::npos) {
+            return false;
+        }
+        for (const char* const* name = wrapper.long_options; *name; ++name) {
+            if (option.substr(2) == *name) {
+                return true;
+            }
+        }
+        return false;
+    }
+    // A cluster such as -Eu: the first letter taking an argument ends it
+    for (size_t i = 1; i < option.size(); ++i) {
+        if (std::strchr(wrapper.short_options, option[i])) {
+            return i + 1 == option.size();
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+const ShellWord* ShellParser::findProgram(const ShellWord* words) {
+    const ShellWord* word = words;
+    while (word && isAssignment(word->text)) {
+        word = word->next;
+    }
+    // for NAME in ..., select NAME in ... and case WORD in run nothing themselves
+    if (word && !word->quoted && (word->text == "for" || word->text == "select" || word->text == "case")) {
+        return nullptr;
+    }
+    while (word) {
+        const Wrapper* wrapper = findWrapper(word->text);
+        if (!wrapper) {
+            return word;
+        }
+        // The wrapper's options and their arguments, up to -- or the first operand
+        word = word->next;
+        while (word) {
+            std::string_view text = word->text;
+            if (text == "--") {
+                word = word->next;
+                break;
+            }
+            if (wrapper->assignments && isAssignment(text)) {
+                word = word->next;
+            } else if (text.size() > 1 && text[0] == '-') {
+                bool argument = takesSeparateArgument(*wrapper, text);
+                word = word->next;
+                if (argument && word) {
+                    word = word->next;
+                }
+            } else {
+                break;
+            }
+        }
+        for (int i = 0; i < wrapper->operands && word; ++i) {
+            word = word->next;
+        }
+    }
+    return nullptr;
+}
+
+bool ShellParser::isAssignment(std::string_view word) {
+    size_t eq = word.find('=');
+    if (eq == 0 || eq == std::string_view::npos) {
+        return false;
+    }
+    for (size_t i = 0; i < eq; ++i) {
+        unsigned char c = static_cast<unsigned char>(word[i]);
+        if (!(std::isalnum(c) || c == '_') || (i == 0 && std::isdigit(c))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ShellArena::~ShellArena() {
+    for (char* block : blocks_) {
+        delete[] block;
+    }
+}
+
+void* ShellArena::allocate(size_t size, size_t align) {
+    size_t padding = (align - reinterpret_cast<uintptr_t>(current_) % align) % align;
+    if (padding + size > remaining_) {
+        size_t block_size = std::max(ARENA_BLOCK_SIZE, size + align);
+        blocks_.push_back(new char[block_size]);
+        current_ = blocks_.back();
+        remaining_ = block_size;
+        padding = (align - reinterpret_cast<uintptr_t>(current_) % align) % align;
+    }
+    void* result = current_ + padding;
+    current_ += padding + size;
+    remaining_ -= padding + size;
+    return result;
+}
+
+std::string_view ShellArena::copy(std::string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+    char* data = static_cast<char*>(allocate(text.size(), 1));
+    std::memcpy(data, text.data(), text.size());
+    return std::string_view(data, text.size());
+}
+
+ShellScript* ShellParser::parse(std::string_view input) {
+    input_ = input;
+    pos_ = 0;
+    failed_ = false;
+    case_depth_ = 0;
+    case_opened_ = false;
+    ShellScript* script = parseScript('\0');
+    return failed_ ? nullptr : script;
+}
+
+void ShellParser::skipBlanks() {
+    while (pos_ < input_.size()) {
+        char c = input_[pos_];
+        if (isBlank(c)) {
+            ++pos_;
+        } else if (c == '\\' && pos_ + 1 < input_.size() && input_[pos_ + 1] == '\n') {
+            pos_ += 2; // Line continuation
+        } else if (c == '#') {
+            while (pos_ < input_.size() && input_[pos_] != '\n') ++pos_;
+        } else {
+            break;
+        }
+    }
+}
+
+bool ShellParser::atReservedWord(std::string_view word) const {
+    if (input_.compare(pos_, word.size(), word) != 0) {
+        return false;
+    }
+    size_t end = pos_ + word.size();
+    return end == input_.size() || isMeta(input_[end]);
+}
+
+bool ShellParser::atRedirect() const {
+    size_t p = pos_;
+    while (p < input_.size() && std::isdigit(static_cast<unsigned char>(input_[p]))) ++p;
+    if (p < input_.size() && (input_[p] == '<' || input_[p] == '>')) {
+        return true;
+    }
+    // &> and &>> redirect both streams
+    return p == pos_ && input_.compare(pos_, 2, "&>") == 0;
+}
+
+ShellScript* ShellParser::parseScript(char terminator) {
+    if (++depth_ > MAX_NESTING) {
+        failed_ = true;
+        return nullptr;
+    }
+    ShellScript* script = arena_.make<ShellScript>();
+    ShellPipeline** tail = &script->pipelines;
+
+    while (!failed_) {
+        // Blank lines and stray separators between commands
+        skipBlanks();
+        while (pos_ < input_.size() && (input_[pos_] == '\n' || input_[pos_] == ';')) {
+            ++pos_;
+            skipBlanks();
+        }
+
+        if (pos_ >= input_.size()) {
+            if (terminator != '\0') {
+                failed_ = true; // Unclosed ( { or $(
+            }
+            break;
+        }
+        if (terminator == ')' && input_[pos_] == ')') {
+            ++pos_;
+            break;
+        }
+        if (terminator == '}' && atReservedWord("}")) {
+            ++pos_;
+            break;
+        }
+
+        ShellPipeline* pipeline = parsePipeline();
+        if (!pipeline) {
+            failed_ = true;
+            break;
+        }
+        *tail = pipeline;
+        tail = &pipeline->next;
+
+        skipBlanks();
+        if (input_.compare(pos_, 2, "&&") == 0 || input_.compare(pos_, 2, "||") == 0) {
+            pipeline->separator = input_.substr(pos_, 2);
+            pos_ += 2;
+        } else if (pos_ < input_.size() && (input_[pos_] == ';' || input_[pos_] == '&' || input_[pos_] == '\n')) {
+            pipeline->separator = input_.substr(pos_, 1);
+            ++pos_;
+        } else if (case_opened_) {
+            case_opened_ = false;   // the first branch follows case WORD in directly
+        } else if (pos_ < input_.size() && !(terminator == ')' && input_[pos_] == ')') &&
+                   !(terminator == '}' && atReservedWord("}"))) {
+            failed_ = true; // e.g. an unmatched )
+        }
+    }
+
+    --depth_;
+    return failed_ ? nullptr : script;
+}
+
+ShellPipeline* ShellParser::parsePipeline() {
+    ShellPipeline* pipeline = arena_.make<ShellPipeline>();
+    skipBlanks();
+    if (atReservedWord("!")) {
+        pipeline->negated = true;
+        ++pos_;
+    }
+
+    ShellCommand** tail = &pipeline->commands;
+    while (true) {
+        ShellCommand* command = parseCommand();
+        if (!command) {
+            return nullptr;
+        }
+        *tail = command;
+        tail = &command->next;
+
+        skipBlanks();
+        if (pos_ < input_.size() && input_[pos_] == '|' && input_.compare(pos_, 2, "||") != 0) {
+            pos_ += input_.compare(pos_, 2, "|&") == 0 ? 2 : 1;
+            // A pipe may be followed by a line break
+            skipBlanks();
+            while (pos_ < input_.size() && input_[pos_] == '\n') {
+                ++pos_;
+                skipBlanks();
+            }
+            continue;
+        }
+        return pipeline;
+    }
+}
+
+ShellCommand* ShellParser::parseCommand() {
+    ShellCommand* command = arena_.make<ShellCommand>();
+    skipBlanks();
+
+    // Keywords such as if/while/do are skipped; the commands they guard are kept
+    while (pos_ < input_.size()) {
+        size_t end = pos_;
+        while (end < input_.size() && !isMeta(input_[end])) ++end;
+        if (end == pos_ || !isSkippedKeyword(input_.substr(pos_, end - pos_))) {
+            break;
+        }
+        if (case_depth_ > 0 && input_.substr(pos_, end - pos_) == "esac") {
+            --case_depth_;
+        }
+        pos_ = end;
+        skipBlanks();
+    }
+
+    // A case pattern such as a|b) or *) before the commands of its branch
+    if (case_depth_ > 0) {
+        size_t end = pos_;
+        while (end < input_.size() && std::strchr(";\n&<>()", input_[end]) == nullptr) ++end;
+        if (end > pos_ && end < input_.size() && input_[end] == ')') {
+            pos_ = end + 1;
+            skipBlanks();
+        }
+    }
+
+    if (pos_ < input_.size() && input_[pos_] == '(') {
+        ++pos_;
+        command->kind = ShellCommand::Kind::Subshell;
+        command->body = parseScript(')');
+    } else if (atReservedWord("{")) {
+        ++pos_;
+        command->kind = ShellCommand::Kind::Group;
+        command->body = parseScript('}');
+    }
+    if (failed_) {
+        return nullptr;
+    }
+
+    ShellWord** word_tail = &command->words;
+    ShellRedirect** redirect_tail = &command->redirects;
+    while (true) {
+        skipBlanks();
+        if (pos_ >= input_.size()) {
+            break;
+        }
+        if (atRedirect()) {
+            ShellRedirect* redirect = parseRedirect();
+            if (!redirect) {
+                return nullptr;
+            }
+            *redirect_tail = redirect;
+            redirect_tail = &redirect->next;
+            continue;
+        }
+
+        char c = input_[pos_];
+        if (c == '(' && command->kind == ShellCommand::Kind::Simple &&
+            command->words && !command->words->next) {
+            // name() compound-command
+            ++pos_;
+            skipBlanks();
+            if (pos_ >= input_.size() || input_[pos_] != ')') {
+                return nullptr;
+            }
+            ++pos_;
+            skipBlanks();
+            while (pos_ < input_.size() && input_[pos_] == '\n') {
+                ++pos_;
+                skipBlanks();
+            }
+            ShellCommand* body = parseCommand();
+            if (!body) {
+                return nullptr;
+            }
+            command->kind = ShellCommand::Kind::Function;
+            command->name = command->words->text;
+            command->words = nullptr;
+            command->body = arena_.make<ShellScript>();
+            command->body->pipelines = arena_.make<ShellPipeline>();
+            command->body->pipelines->commands = body;
+            return command;
+        }
+        if (isMeta(c)) {
+            break;
+        }
+        if (command->kind != ShellCommand::Kind::Simple) {
+            return nullptr; // Words after ) or } are a syntax error
+        }
+
+        ShellWord* word = parseWord();
+        if (!word) {
+            return nullptr;
+        }
+        *word_tail = word;
+        word_tail = &word->next;
+        // case WORD in: the branches follow without a separator
+        if (word->text == "in" && !word->quoted && command->words->text == "case" &&
+            command->words->next && command->words->next->next == word) {
+            ++case_depth_;
+            case_opened_ = true;
+            break;
+        }
+    }
+    return command;
+}
+
+ShellRedirect* ShellParser::parseRedirect() {
+    size_t start = pos_;
+    while (pos_ < input_.size() && std::isdigit(static_cast<unsigned char>(input_[pos_]))) ++pos_;
+    static const char* const operators[] = {
+        "&>>", "&>", "<<<", "<<-", "<<", "<>", "<&", ">>", ">&", ">|", "<", ">"
+    };
+    for (const char* op : operators) {
+        size_t length = std::strlen(op);
+        if (input_.compare(pos_, length, op) == 0) {
+            pos_ += length;
+            break;
+        }
+    }
+
+    ShellRedirect* redirect = arena_.make<ShellRedirect>();
+    redirect->op = input_.substr(start, pos_ - start);
+    skipBlanks();
+    if (pos_ >= input_.size() || isMeta(input_[pos_])) {
+        return nullptr; // Redirection without a target
+    }
+    redirect->target = parseWord();
+    return redirect->target ? redirect : nullptr;
+}
+
+ShellWord* ShellParser::parseWord() {
+    ShellWord* word = arena_.make<ShellWord>();
+    ShellScript** substitutions = &word->substitutions;
+    size_t start = pos_;
+    bool literal = true;    // no quotes, escapes or expansions: the text is the raw slice
+    std::string text;
+
+    while (pos_ < input_.size() && !failed_) {
+        char c = input_[pos_];
+        if (isMeta(c)) {
+            break;
+        }
+        if (c == '\\') {
+            literal = false;
+            word->quoted = true;
+            if (pos_ + 1 < input_.size() && input_[pos_ + 1] != '\n') {
+                text += input_[pos_ + 1];
+            }
+            pos_ += 2;
+        } else if (c == '\'') {
+            size_t close = input_.find('\'', pos_ + 1);
+            if (close == std::string_view::npos) {
+                failed_ = true;
+                break;
+            }
+            literal = false;
+            word->quoted = true;
+            text.append(input_.substr(pos_ + 1, close - pos_ - 1));
+            pos_ = close + 1;
+        } else if (c == '"') {
+            literal = false;
+            word->quoted = true;
+            ++pos_;
+            while (pos_ < input_.size() && input_[pos_] != '"' && !failed_) {
+                char d = input_[pos_];
+                if (d == '\\' && pos_ + 1 < input_.size() && std::strchr("$`\"\\\n", input_[pos_ + 1])) {
+                    if (input_[pos_ + 1] != '\n') {
+                        text += input_[pos_ + 1];
+                    }
+                    pos_ += 2;
+                } else if (d == '$' || d == '`') {
+                    parseExpansion(text, substitutions);
+                } else {
+                    text += d;
+                    ++pos_;
+                }
+            }
+            if (pos_ >= input_.size()) {
+                failed_ = true;
+                break;
+            }
+            ++pos_;
+        } else if (c == '$' || c == '`') {
+            literal = false;
+            parseExpansion(text, substitutions);
+        } else {
+            text += c;
+            ++pos_;
+        }
+    }
+
+    if (failed_) {
+        return nullptr;
+    }
+    word->text = literal ? input_.substr(start, pos_ - start) : arena_.copy(text);
+    return word;
+}
+
+// $(...), `...`, $((...)), ${...} and plain $: the raw text is kept in the
+// word and command substitutions are also parsed into their own scripts
+bool ShellParser::parseExpansion(std::string& text, ShellScript**& substitutions) {
+    size_t start = pos_;
+
+    if (input_[pos_] == '`') {
+        std::string inner;
+        size_t p = pos_ + 1;
+        while (p < input_.size() && input_[p] != '`') {
+            if (input_[p] == '\\' && p + 1 < input_.size() && std::strchr("$`\\", input_[p + 1])) {
+                ++p;
+            }
+            inner += input_[p++];
+        }
+        if (p >= input_.size()) {
+            failed_ = true;
+            return false;
+        }
+        pos_ = p + 1;
+
+        ShellParser nested(arena_);
+        nested.depth_ = depth_ + 1;
+        ShellScript* script = nested.parse(arena_.copy(inner));
+        if (!script) {
+            failed_ = true;
+            return false;
+        }
+        *substitutions = script;
+        substitutions = &script->next;
+        text.append(input_.substr(start, pos_ - start));
+        return true;
+    }
+
+    if (input_.compare(pos_, 3, "$((") == 0) {
+        // Arithmetic: kept verbatim up to the matching ))
+        int parens = 0;
+        size_t p = pos_ + 1;
+        for (; p < input_.size(); ++p) {
+            if (input_[p] == '(') ++parens;
+            else if (input_[p] == ')' && --parens == 0) break;
+        }
+        if (p >= input_.size()) {
+            failed_ = true;
+            return false;
+        }
+        pos_ = p + 1;
+    } else if (input_.compare(pos_, 2, "$(") == 0) {
+        pos_ += 2;
+        ShellScript* script = parseScript(')');
+        if (!script) {
+            failed_ = true;
+            return false;
+        }
+        *substitutions = script;
+        substitutions = &script->next;
+    } else if (input_.compare(pos_, 2, "${") == 0) {
+        size_t close = input_.find('}', pos_ + 2);
+        if (close == std::string_view::npos) {
+            failed_ = true;
+            return false;
+        }
+        pos_ = close + 1;
+    } else {
+        ++pos_;
+    }
+    text.append(input_.substr(start, pos_ - start));
+    return true;
+}
+
+} // namespace ganpi
@@ -0,0 +1,61 @@
+#include "ganpi.h"
+#include <cstdio>
+
+namespace ganpi {
+
+namespace {
+
+const char* const PHASE_NAMES[Timings::PhaseCount] = {
+    "context", "prompt", "serialize", "warmup_wait", "dns", "connect", "tls", "ttfb",
+    "transfer", "backoff", "parse", "extract", "validate", "confirm", "execute", "total"
+};
+
+} // namespace
+
+Timings::Scope::Scope(Timings* timings, Phase phase)
+    : timings_(timings), phase_(phase), start_(std::chrono::steady_clock::now()) {
+}
+
+Timings::Scope::~Scope() {
+    if (timings_) {
+        timings_->add(phase_, std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start_).count());
+    }
+}
+
+void Timings::reset() {
+    for (double& ms : ms_) {
+        ms = 0.0;
+    }
+    source_ = "api";
+}
+
+const char* Timings::name(Phase phase) {
+    return PHASE_NAMES[phase];
+}
+
+std::string Timings::report() const {
+    std::string out = "⏱️  Timings (" + std::string(source_) + "):\n";
+    char line[64];
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        // Phases that did not happen for this request are left out, except the total
+        if (ms_[phase] <= 0.0 && phase != Total) {
+            continue;
+        }
+        snprintf(line, sizeof(line), "   %-12s %10.2f ms\n", PHASE_NAMES[phase], ms_[phase]);
+        out += line;
+    }
+    return out;
+}
+
+std::string Timings::json() const {
+    std::string out = "{\"source\":\"" + std::string(source_) + "\"";
+    char field[64];
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        snprintf(field, sizeof(field), ",\"%s_ms\":%.3f", PHASE_NAMES[phase], ms_[phase]);
+        out += field;
+    }
+    return out + "}";
+}
+
+} // namespace ganpi
@@ -0,0 +1,85 @@
+// GeminiClient with a ResponseCache against MockGeminiServer: an answer is
+// cached only once its command ran, a declined cached answer is evicted,
+// speculations never reach the cache and --no-cache still asks the API.
+
+#include "ganpi.h"
+#include "mock_gemini_server.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+using namespace ganpi;
+
+namespace {
+
+const char* REQUEST = "list the files in this directory";
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "✅ " : "❌ ") << what << std::endl;
+    if (!ok) ++failures;
+}
+
+// Asks once and reports how many POSTs the server saw for it
+long ask(GeminiClient& client, MockGeminiServer& server, std::string& command) {
+    long before = server.postsReceived();
+    command = client.interpretCommand(REQUEST);
+    return server.postsReceived() - before;
+}
+
+} // namespace
+
+int main() {
+    MockGeminiServer server;
+
+    char cache_template[] = "/tmp/ganpi_cache.XXXXXX";
+    int cache_fd = mkstemp(cache_template);
+    if (cache_fd < 0) {
+        std::perror("mkstemp");
+        return 1;
+    }
+    close(cache_fd);
+    std::string cache_path = cache_template;
+    std::remove(cache_path.c_str());
+
+    Log::setLevel(LogLevel::Quiet);
+    {
+        GeminiClient client("check-key");
+        client.setBaseUrl(server.baseUrl());
+        client.setLocalIntentThreshold(2.0);   // always ask the API
+        client.setResponseCache(std::make_unique<ResponseCache>(cache_path));
+
+        std::string command;
+        ask(client, server, command);
+        uint64_t key = client.lastCacheKey();
+        check(key != 0, "an API answer has a cache key");
+        check(ask(client, server, command) == 1, "an answer nobody ran is not cached");
+
+        client.acceptCommand(client.lastCacheKey(), command);
+        check(ask(client, server, command) == 0 && command == "ls -la", "an answer that ran is cached");
+
+        client.setCacheLookups(false);
+        check(ask(client, server, command) == 1, "--no-cache asks the API despite a cached answer");
+        client.setCacheLookups(true);
+
+        client.declineCommand(client.lastCacheKey());
+        check(ask(client, server, command) == 1, "a declined answer is evicted");
+
+        client.declineCommand(client.lastCacheKey());
+        long before = server.postsReceived();
+        client.speculate(REQUEST);
+        command = client.interpretCommand(REQUEST);
+        check(command == "ls -la" && client.lastCacheKey() == key, "a speculation answers with its cache key");
+        check(ask(client, server, command) == 1 && server.postsReceived() - before == 2,
+              "a speculation is not cached");
+    }
+
+    std::remove(cache_path.c_str());
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+// Config: every setting read from a config file is written back by
+// saveToFile, and paths starting with ~ expand to the home directory.
+
+#include "ganpi.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include <unistd.h>
+
+using namespace ganpi;
+
+namespace {
+
+const char* const SETTINGS[] = {
+    "GEMINI_API_KEY=check-key",
+    "MODEL=gemini-check",
+    "API_BASE_URL=http://127.0.0.1:9/v1beta",
+    "STREAMING=true",
+    "RESPONSE_CACHE=~/check_cache",
+    "RESPONSE_CACHE_TTL=60",
+    "RESPONSE_CACHE_ENTRIES=128",
+    "BATCH_CONCURRENCY=2",
+    "CANDIDATES=3",
+    "SAFETY_RULES=~/check_rules",
+    "LOCAL_INTENTS=off",
+    "CONTEXT_TOKEN_BUDGET=500",
+    "CONNECT_TIMEOUT_MS=2000",
+    "REQUEST_DEADLINE_MS=9000",
+    "RETRIES=5",
+    "RETRY_BASE_MS=100",
+    "HEDGE_AFTER_MS=auto",
+    "SPECULATE_AFTER_MS=250",
+    "TIMINGS_LOG=~/check_timings.jsonl",
+    "LOG_LEVEL=verbose",
+};
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "✅ " : "❌ ") << what << std::endl;
+    if (!ok) ++failures;
+}
+
+std::string tempPath() {
+    char path[] = "/tmp/ganpi_config.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0) close(fd);
+    return path;
+}
+
+} // namespace
+
+int main() {
+    setenv("HOME", "/home/check", 1);
+    unsetenv("USERPROFILE");
+    Log::setLevel(LogLevel::Quiet);
+
+    std::string in_path = tempPath();
+    std::string out_path = tempPath();
+    {
+        std::ofstream in(in_path);
+        for (const char* setting : SETTINGS) in << setting << "\n";
+    }
+
+    Config& config = Config::getInstance();
+    check(config.loadFromFile(in_path), "config file loads");
+    check(config.getResponseCachePath() == "/home/check/check_cache", "RESPONSE_CACHE expands ~");
+    check(config.getSafetyRulesPath() == "/home/check/check_rules", "SAFETY_RULES expands ~");
+    check(config.getTimingsLogPath() == "/home/check/check_timings.jsonl", "TIMINGS_LOG expands ~");
+
+    config.saveToFile(out_path);
+    std::set<std::string> saved;
+    {
+        std::ifstream out(out_path);
+        std::string line;
+        while (std::getline(out, line)) saved.insert(line);
+    }
+    for (const char* setting : SETTINGS) {
+        check(saved.count(setting) == 1, std::string("saved ") + setting);
+    }
+
+    std::remove(in_path.c_str());
+    std::remove(out_path.c_str());
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+// ganpid against MockGeminiServer: clients in different directories must
+// get their own file system context, and malformed requests must be
+// refused without taking the daemon down.
+
+#include "ganpi.h"
+#include "mock_gemini_server.h"
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <ftw.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace ganpi;
+using json = nlohmann::json;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "✅ " : "❌ ") << what << std::endl;
+    if (!ok) ++failures;
+}
+
+int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+    return ::remove(path);
+}
+
+// One request line to the daemon and its reply; null when it did not answer
+json ask(const std::string& socket_path, const std::string& line) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        if (fd >= 0) close(fd);
+        return json();
+    }
+    std::string data = line + "\n";
+    std::string reply;
+    if (send(fd, data.data(), data.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(data.size())) {
+        char buffer[4096];
+        ssize_t n;
+        while (reply.find('\n') == std::string::npos && (n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            reply.append(buffer, static_cast<size_t>(n));
+        }
+    }
+    close(fd);
+    return json::parse(reply, nullptr, false);
+}
+
+json translate(const std::string& socket_path, const std::string& cwd) {
+    return ask(socket_path, json{{"op", "translate"}, {"cwd", cwd},
+                                 {"request", "show the text files here"}}.dump());
+}
+
+} // namespace
+
+int main() {
+    MockGeminiServer server;
+
+    char root_template[] = "/tmp/ganpi_check.XXXXXX";
+    if (!mkdtemp(root_template)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::string root = root_template;
+    std::string home = root + "/home", dir_a = root + "/a", dir_b = root + "/b";
+    for (const auto& dir : {home, dir_a, dir_b}) {
+        mkdir(dir.c_str(), 0700);
+    }
+    std::ofstream(dir_a + "/only_in_a.txt") << "a\n";
+    std::ofstream(dir_b + "/only_in_b.txt") << "b\n";
+    std::ofstream(home + "/.ganpi_config") << "GEMINI_API_KEY=check-key\n"
+                                           << "API_BASE_URL=" << server.baseUrl() << "\n"
+                                           << "LOCAL_INTENTS=off\n"
+                                           << "RESPONSE_CACHE=off\n"
+                                           << "LOG_LEVEL=quiet\n";
+    setenv("HOME", home.c_str(), 1);
+    std::string socket_path = root + "/ganpid.sock";
+
+    GANPI daemon;
+    daemon.setLogLevel(LogLevel::Quiet);
+    if (!daemon.initialize()) {
+        std::cout << "❌ initialize failed" << std::endl;
+        return 1;
+    }
+    std::thread daemon_thread([&]() { daemon.runDaemon(socket_path); });
+    json pong;
+    for (int i = 0; i < 100 && !pong.is_object(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        pong = ask(socket_path, R"({"op":"ping"})");
+    }
+    check(pong.is_object() && pong.contains("pid"), "daemon answers ping");
+
+    // Each client's listing, not the daemon's starting directory or the previous client's
+    json reply_a = translate(socket_path, dir_a);
+    std::string body_a = server.lastRequestBody();
+    json reply_b = translate(socket_path, dir_b);
+    std::string body_b = server.lastRequestBody();
+    check(reply_a.is_object() && reply_a.value("command", "") == "ls -la", "client in a gets a command");
+    check(body_a.find("only_in_a.txt") != std::string::npos && body_a.find("only_in_b.txt") == std::string::npos,
+          "client in a is sent the listing of a");
+    check(reply_b.is_object() && reply_b.value("command", "") == "ls -la", "client in b gets a command");
+    check(body_b.find("only_in_b.txt") != std::string::npos && body_b.find("only_in_a.txt") == std::string::npos,
+          "client in b is sent the listing of b");
+
+    // Well-formed JSON with the wrong types is refused, and the daemon keeps running
+    json bad = ask(socket_path, R"({"op":"translate","cwd":1,"request":["x"]})");
+    check(bad.is_object() && bad.contains("error"), "non-string cwd is refused with an error");
+    json bad_op = ask(socket_path, R"({"op":42})");
+    check(bad_op.is_object(), "non-string op gets a reply");
+    pong = ask(socket_path, R"({"op":"ping"})");
+    check(pong.is_object() && pong.contains("pid"), "daemon survives malformed requests");
+
+    GANPI::stopDaemon(socket_path);
+    daemon_thread.join();
+    nftw(root.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+// DirectorySnapshotCache: the number of snapshots is capped, the least
+// recently used one is evicted together with its inotify watch, and the
+// snapshots that remain are still kept fresh, down to the context text
+// ContextCollector renders from them.
+
+#include "ganpi.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ganpi;
+
+namespace {
+
+const size_t CAPACITY = 4;
+const int DIRECTORIES = 10;
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "✅ " : "❌ ") << what << std::endl;
+    if (!ok) ++failures;
+}
+
+bool contains(const DirectoryListing& listing, const std::string& name) {
+    for (const auto& entry : listing.entries) {
+        if (entry.name == name) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int main() {
+    char root_template[] = "/tmp/ganpi_dirs.XXXXXX";
+    if (!mkdtemp(root_template)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::string root = root_template;
+    for (int i = 0; i < DIRECTORIES; ++i) {
+        mkdir((root + "/d" + std::to_string(i)).c_str(), 0755);
+    }
+
+    {
+        DirectorySnapshotCache cache(CAPACITY);
+        for (int i = 0; i < DIRECTORIES; ++i) {
+            cache.get(root + "/d" + std::to_string(i));
+        }
+        check(cache.snapshots() == CAPACITY, std::to_string(cache.snapshots()) + " snapshots kept of " +
+                                             std::to_string(DIRECTORIES) + " directories listed");
+#ifdef __linux__
+        check(cache.watches() == CAPACITY, std::to_string(cache.watches()) + " inotify watches left");
+#endif
+
+        // Touching d6 keeps it while d7 becomes the oldest
+        std::string kept = root + "/d6";
+        cache.get(kept);
+        cache.get(root + "/d0");
+        size_t scans = cache.fullScans();
+        cache.get(kept);
+        check(cache.fullScans() == scans, "a recently used snapshot survives an eviction");
+        cache.get(root + "/d7");
+        check(cache.fullScans() == scans + 1, "the least recently used snapshot was evicted");
+
+        uint64_t version = cache.get(kept).version;
+        check(cache.get(kept).version == version, "an unchanged listing keeps its version");
+        std::ofstream(kept + "/new.txt") << "x";
+        const DirectoryListing& listing = cache.get(kept);
+        check(contains(listing, "new.txt"), "a kept snapshot still sees new files");
+        check(listing.version != version, "a changed listing gets a new version");
+        std::remove((kept + "/new.txt").c_str());
+    }
+
+    // ContextCollector reuses rendered listings only while they are unchanged
+    {
+        char saved[4096];
+        if (getcwd(saved, sizeof(saved)) && chdir(root.c_str()) == 0) {
+            ContextCollector collector;
+            std::string before = collector.collect("list the files");
+            check(collector.collect("list the files") == before, "a warm context matches the cold one");
+            std::ofstream(root + "/added.txt") << "x";
+            std::string after = collector.collect("list the files");
+            check(after.find("added.txt") != std::string::npos, "a new file shows up in the warm context");
+            std::remove((root + "/added.txt").c_str());
+            check(chdir(saved) == 0, "back in the original directory");
+        }
+    }
+
+    for (int i = 0; i < DIRECTORIES; ++i) {
+        rmdir((root + "/d" + std::to_string(i)).c_str());
+    }
+    rmdir(root.c_str());
+    return failures == 0 ? 0 : 1;
+}
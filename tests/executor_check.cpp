@@ -0,0 +1,41 @@
+// CommandExecutor: stdout and stderr are captured each on their own, with
+// the interleaved output kept alongside, and the exit status is decoded.
+
+#include "ganpi.h"
+
+#include <iostream>
+#include <string>
+
+using namespace ganpi;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "✅ " : "❌ ") << what << std::endl;
+    if (!ok) ++failures;
+}
+
+} // namespace
+
+int main() {
+    CommandExecutor executor;
+    executor.setStreamOutput(false);
+
+    auto result = executor.execute("printf out1; sleep 0.05; printf err1 >&2; sleep 0.05; printf out2");
+    check(result.success && result.exit_code == 0, "the command succeeds");
+    check(result.stdout_output == "out1out2", "stdout on its own: \"" + result.stdout_output + "\"");
+    check(result.stderr_output == "err1", "stderr on its own: \"" + result.stderr_output + "\"");
+    check(result.output == "out1err1out2", "both interleaved in arrival order: \"" + result.output + "\"");
+
+    auto quiet_stdout = executor.execute("printf oops >&2; exit 3");
+    check(!quiet_stdout.success && quiet_stdout.exit_code == 3, "exit status 3 is reported");
+    check(quiet_stdout.stdout_output.empty() && quiet_stdout.stderr_output == "oops",
+          "stderr only: stdout stays empty");
+
+    auto killed = executor.execute("kill -TERM $$");
+    check(killed.term_signal == 15 && killed.exit_code == 128 + 15, "a signal is decoded as 128+N");
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+// GeminiClient request policy against MockGeminiServer: a 429's Retry-After
+// is waited out but never past the deadline, a 5xx is retried up to
+// max_retries and then given up on, and a hedged request goes out only once
+// its delay has passed, with the losing request cancelled.
+
+#include "ganpi.h"
+#include "mock_gemini_server.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace ganpi;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "✅ " : "❌ ") << what << std::endl;
+    if (!ok) ++failures;
+}
+
+// Client for server; backoff jitter is off so only Retry-After waits
+struct Client {
+    GeminiClient client{"check-key"};
+    GeminiClient::RequestPolicy policy;
+
+    explicit Client(MockGeminiServer& server) {
+        client.setBaseUrl(server.baseUrl());
+        client.setLocalIntentThreshold(2.0);   // always ask the API
+        policy.retry_base_ms = 0;
+    }
+
+    // Asks once; returns the milliseconds it took
+    double ask(std::string& command) {
+        client.setRequestPolicy(policy);
+        auto start = std::chrono::steady_clock::now();
+        command = client.interpretCommand("list the files in this directory");
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+std::string describe(double elapsed_ms, const std::string& error) {
+    return " (" + std::to_string(static_cast<long>(elapsed_ms)) + " ms" +
+           (error.empty() ? "" : ", " + error) + ")";
+}
+
+// Waits for the server thread to notice a hang-up
+void settle(MockGeminiServer& server, long abandoned) {
+    for (int i = 0; i < 100 && server.postsAbandoned() < abandoned; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+} // namespace
+
+int main() {
+    Log::setLevel(LogLevel::Quiet);
+    std::string command;
+
+    {
+        MockGeminiServer server;
+        server.setFailureEvery(2, 429, 1);   // the first POST answers, the second is throttled
+        Client client(server);
+        client.ask(command);
+        double elapsed_ms = client.ask(command);
+        check(command == "ls -la" && elapsed_ms >= 1000 && server.postsReceived() == 3,
+              "429 with Retry-After: 1 is waited out, then retried" + describe(elapsed_ms, client.client.lastError()));
+    }
+
+    {
+        MockGeminiServer server;
+        server.setFailureEvery(1, 429, 30);
+        Client client(server);
+        client.policy.deadline_ms = 2000;
+        double elapsed_ms = client.ask(command);
+        check(command.empty() && elapsed_ms < 1000 && server.postsReceived() == 1 &&
+              client.client.lastError().find("deadline") != std::string::npos,
+              "a Retry-After beyond the deadline gives up at once" + describe(elapsed_ms, client.client.lastError()));
+    }
+
+    {
+        MockGeminiServer server;
+        server.setFailureEvery(1, 503);
+        Client client(server);
+        client.policy.max_retries = 2;
+        double elapsed_ms = client.ask(command);
+        check(command.empty() && server.postsReceived() == 3 &&
+              client.client.lastError() == "HTTP 503 after 3 attempts",
+              "503 is retried twice, then given up on" + describe(elapsed_ms, client.client.lastError()));
+    }
+
+    {
+        MockGeminiServer server;
+        server.setSlowEvery(2, std::chrono::milliseconds(5000));   // the second POST stalls
+        Client client(server);
+        client.policy.hedge_after_ms = 300;
+        double fast_ms = client.ask(command);
+        check(command == "ls -la" && server.postsReceived() == 1,
+              "a quick answer sends no hedge" + describe(fast_ms, client.client.lastError()));
+        double hedged_ms = client.ask(command);
+        check(command == "ls -la" && server.postsReceived() == 3 && hedged_ms >= 300 && hedged_ms < 2000,
+              "a stalled request is hedged after 300 ms" + describe(hedged_ms, client.client.lastError()));
+        settle(server, 1);
+        check(server.postsAbandoned() == 1, "the stalled request is cancelled once the hedge answers");
+    }
+
+    return failures == 0 ? 0 : 1;
+}
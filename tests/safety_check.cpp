@@ -0,0 +1,49 @@
+// SafetyEngine verdicts for recursive rm targets: the filesystem root, home
+// and top-level directories are blocked (the executor drops those), the
+// current directory's contents only warrant a warning. Wrapper options
+// (sudo -u USER, timeout DURATION, ...) must not hide the command.
+
+#include "ganpi.h"
+
+#include <iostream>
+#include <string>
+
+using namespace ganpi;
+
+namespace {
+
+int failures = 0;
+
+void expect(const SafetyEngine& engine, const std::string& command, SafetyEngine::Verdict verdict) {
+    SafetyEngine::Match match = engine.classify(command);
+    bool ok = match.verdict == verdict;
+    std::cout << (ok ? "✅ " : "❌ ") << command << " -> " << static_cast<int>(match.verdict)
+              << (match.pattern.empty() ? "" : " (" + match.pattern + ")") << std::endl;
+    if (!ok) ++failures;
+}
+
+} // namespace
+
+int main() {
+    using Verdict = SafetyEngine::Verdict;
+    SafetyEngine engine;
+
+    for (const char* command : {"rm -rf /", "rm -rf /*", "rm -rf /.", "rm -rf //", "rm -rf ~",
+                                "rm -rf ~/*", "rm -rf $HOME/", "rm -rf /usr", "rm -rf /etc/",
+                                "rm -r /home/*", "rm -rf /boot", "sudo rm -r /var",
+                                "timeout 5 rm -fr /", "nice -n 10 rm -fr /", "xargs -n 1 rm -fr /",
+                                "sudo -u root rm -fr /", "env -u HOME X=1 rm -rf /", "sudo -Eu root rm -rf ~",
+                                "stdbuf -o L timeout -s KILL 10 rm -rf /usr", "chroot /mnt rm -rf /",
+                                "for f in *; do rm -rf /; done", "case $1 in a|b) rm -rf / ;; esac"}) {
+        expect(engine, command, Verdict::Block);
+    }
+    for (const char* command : {"rm -rf *", "rm -rf ./*", "rm -rf build", "rm -rf /tmp/build",
+                                "rm -rf '*'", "rm -rf '~'"}) {
+        expect(engine, command, Verdict::Warn);
+    }
+    for (const char* command : {"rm file.txt", "rm -f /etc", "ls /usr", "timeout 5 ls /", "nice -n 10 rm file.txt"}) {
+        expect(engine, command, Verdict::Safe);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
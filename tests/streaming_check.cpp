@@ -0,0 +1,68 @@
+// GeminiClient streaming against MockGeminiServer: the command arrives in
+// the first SSE event and the server then holds the rest back, so each
+// request must return and hang up without waiting for the remainder.
+// Cutting an HTTP/1.1 response short costs its connection, so here every
+// streamed request opens a new one.
+
+#include "ganpi.h"
+#include "mock_gemini_server.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace ganpi;
+
+namespace {
+
+const int REQUESTS = 4;
+const auto PAUSE = std::chrono::milliseconds(3000);
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "✅ " : "❌ ") << what << std::endl;
+    if (!ok) ++failures;
+}
+
+} // namespace
+
+int main() {
+    MockGeminiServer server;
+    server.setStreamPause(PAUSE);
+
+    Log::setLevel(LogLevel::Quiet);
+    {
+        GeminiClient client("check-key");
+        client.setBaseUrl(server.baseUrl());
+        client.setLocalIntentThreshold(2.0);   // always ask the API
+        client.setStreaming(true);
+
+        int answered = 0;
+        double slowest_ms = 0.0;
+        for (int i = 0; i < REQUESTS; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            std::string command = client.interpretCommand("list the files in directory " + std::to_string(i));
+            double elapsed_ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+            if (command == "ls -la") ++answered;
+            if (elapsed_ms > slowest_ms) slowest_ms = elapsed_ms;
+        }
+        check(answered == REQUESTS, std::to_string(answered) + " of " + std::to_string(REQUESTS) +
+                                    " streamed requests answered");
+        check(slowest_ms < PAUSE.count() / 2, "slowest request took " + std::to_string(slowest_ms) +
+                                              " ms; the rest of the stream was not awaited");
+
+        // The server notices the hang-up on its own thread
+        for (int i = 0; i < 100 && server.streamsCancelled() < REQUESTS; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        check(server.streamsCancelled() == REQUESTS, std::to_string(server.streamsCancelled()) +
+                                                      " stream(s) cancelled by the client");
+        check(client.connectionsOpened() == REQUESTS, std::to_string(client.connectionsOpened()) +
+                                                      " connection(s) opened; a cancelled stream closes its own");
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+// GeminiClient against MockGeminiServer over HTTPS: consecutive requests,
+// the connection warm-up included, must share one connection and so one
+// TLS handshake.
+
+#include "ganpi.h"
+#include "mock_gemini_server.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+using namespace ganpi;
+
+namespace {
+
+const int REQUESTS = 8;
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "✅ " : "❌ ") << what << std::endl;
+    if (!ok) ++failures;
+}
+
+} // namespace
+
+int main() {
+    MockGeminiServer server(true);
+
+    char ca_template[] = "/tmp/ganpi_ca.XXXXXX";
+    int ca_fd = mkstemp(ca_template);
+    if (ca_fd < 0) {
+        std::perror("mkstemp");
+        return 1;
+    }
+    close(ca_fd);
+    std::string ca_path = ca_template;
+    std::ofstream(ca_path) << server.certificatePem();
+
+    Log::setLevel(LogLevel::Quiet);
+    {
+        GeminiClient client("check-key");
+        client.setBaseUrl(server.baseUrl());
+        client.setCaBundle(ca_path);
+        client.setLocalIntentThreshold(2.0);   // always ask the API
+
+        int answered = 0;
+        for (int i = 0; i < REQUESTS; ++i) {
+            std::string command = client.interpretCommand("list the files in directory " + std::to_string(i));
+            if (command == "ls -la") ++answered;
+        }
+        check(answered == REQUESTS, std::to_string(answered) + " of " + std::to_string(REQUESTS) +
+                                    " requests answered over HTTPS");
+        check(server.connectionsAccepted() == 1, std::to_string(server.connectionsAccepted()) +
+                                                 " connection(s) accepted for " + std::to_string(REQUESTS) +
+                                                 " requests");
+        check(client.connectionsOpened() == 1, std::to_string(client.connectionsOpened()) +
+                                               " connection(s) opened by the client");
+    }
+
+    std::remove(ca_path.c_str());
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+// CommandValidator: wrapper options, loop variables and case subjects are
+// not programs, so correct commands report nothing missing, while real
+// misses are reported and ranked last.
+
+#include "ganpi.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace ganpi;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "✅ " : "❌ ") << what << std::endl;
+    if (!ok) ++failures;
+}
+
+std::string describe(const CommandCandidate& candidate) {
+    std::string text = candidate.command + " -> " + (candidate.parses ? "parses" : "does not parse");
+    for (const auto& program : candidate.missing_programs) text += ", missing program " + program;
+    for (const auto& path : candidate.missing_paths) text += ", missing path " + path;
+    return text;
+}
+
+} // namespace
+
+int main() {
+    CommandValidator validator;
+
+    for (const char* command : {"timeout 5 ls", "nice -n 10 ls", "xargs -n 1 wc -l", "sudo -u root ls",
+                                "env -u HOME LANG=C ls", "stdbuf -o L timeout -s KILL 10 ls",
+                                "for f in *.txt; do wc -l \"$f\"; done", "select f in a b; do echo \"$f\"; done",
+                                "case $1 in a|b) ls ;; *) wc -l /dev/null ;; esac"}) {
+        CommandCandidate candidate = validator.validate(command);
+        check(candidate.parses && candidate.missing_programs.empty() && candidate.missing_paths.empty(),
+              describe(candidate));
+    }
+
+    CommandCandidate missing = validator.validate("timeout 5 ganpi_no_such_program -x");
+    check(missing.missing_programs == std::vector<std::string>{"ganpi_no_such_program"}, describe(missing));
+    CommandCandidate in_loop = validator.validate("for f in a; do ganpi_no_such_program \"$f\"; done");
+    check(in_loop.missing_programs == std::vector<std::string>{"ganpi_no_such_program"}, describe(in_loop));
+    CommandCandidate path = validator.validate("cat /ganpi/no/such/file");
+    check(!path.missing_paths.empty(), describe(path));
+
+    std::vector<CommandCandidate> ranked = validator.rank({"ganpi_no_such_program", "nice -n 10 ls"});
+    check(ranked.size() == 2 && ranked[0].command == "nice -n 10 ls", "a working wrapped command ranks first");
+
+    return failures == 0 ? 0 : 1;
+}